@@ -0,0 +1,770 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The benchmarks and golden check of the video plugin.
+//!
+//! @details Measures the kernels of the per-pixel Kalman filter engine across
+//! resolutions, formats, modes, and worker counts, then the element end to end
+//! in headless pipelines. Checks the engine estimates against the general
+//! Kalman filter library, bit for bit. Reports in JSON for the results of
+//! revisions to be compared.
+
+#include "pixel_kalman.hpp"
+#include "statistics.hpp"
+#include "worker_pool.hpp"
+
+#include <fcarouge/kalman.hpp>
+#include <glib-object.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <scope.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fcarouge::benchmark {
+namespace {
+
+//! @brief The monotonic clock of the measurements.
+using clock = std::chrono::steady_clock;
+
+//! @brief The general library filter of the golden check.
+using kalman = fcarouge::kalman<float, float>;
+
+//! @brief The geometry of a plane of a video format.
+struct plane_format {
+  //! @brief The horizontal subsampling of the plane.
+  std::size_t horizontal{1};
+
+  //! @brief The vertical subsampling of the plane.
+  std::size_t vertical{1};
+
+  //! @brief The number of interleaved samples of a pixel of the plane.
+  std::size_t components{1};
+};
+
+//! @brief A raw video format of the element capabilities.
+struct video_format {
+  //! @brief The GStreamer name of the format.
+  std::string_view name;
+
+  //! @brief The greatest value of a sample.
+  std::uint16_t maximum{255};
+
+  //! @brief The planes of the format.
+  std::vector<plane_format> planes;
+};
+
+//! @brief A filtering mode of the element.
+struct mode {
+  //! @brief The name of the mode.
+  std::string_view name;
+
+  //! @brief The element properties of the mode.
+  std::string_view properties;
+
+  //! @brief The engine configuration of the mode.
+  pixel_kalman::configuration configuration;
+
+  //! @brief The greatest difference of the samples to the library filter, in
+  //! code values of at most 10 bits, the single precision samples and state
+  //! being exact.
+  int tolerance{0};
+
+  //! @brief The number of pixels of the side of the square blocks of pixels
+  //! sharing a filter, the filters of blocks having no library reference.
+  std::size_t granularity{1};
+
+  //! @brief Whether the frames are filtered out of place, from read-only
+  //! input frames.
+  bool out_of_place{false};
+
+  //! @brief Whether the mode only differs from the other modes in the
+  //! element, without a distinct kernel nor golden check.
+  bool pipeline_only{false};
+};
+
+//! @brief The frames of the pseudo-random samples of a format.
+template <typename Pixel> struct frames {
+  //! @brief The samples of each frame and plane.
+  std::vector<std::vector<std::vector<Pixel>>> samples;
+
+  //! @brief The views of the planes of each frame.
+  std::vector<std::vector<plane<Pixel>>> planes;
+};
+
+//! @brief The results of a kernel measurement.
+struct kernel_result {
+  std::string_view format;
+  std::size_t width{0};
+  std::size_t height{0};
+  std::string_view mode;
+  std::size_t threads{0};
+  double ns_per_pixel{0};
+  double gb_per_second{0};
+};
+
+//! @brief The results of a pipeline measurement.
+struct pipeline_result {
+  std::string_view format;
+  std::size_t width{0};
+  std::size_t height{0};
+  std::string_view mode;
+  bool completed{false};
+  double fps{0};
+  double latency_p50_us{0};
+  double latency_p90_us{0};
+  double latency_p99_us{0};
+  std::size_t rss_kib{0};
+};
+
+//! @brief The results of the golden check.
+struct golden_result {
+  std::size_t cases{0};
+  std::size_t mismatches{0};
+};
+
+//! @brief The options of the command line.
+struct options {
+  bool kernel{false};
+  bool pipeline{false};
+  bool golden{false};
+  std::size_t frames{10};
+  std::string output;
+};
+
+//! @brief The formats of the measurements, of each sample size and layout.
+const std::array formats{
+    video_format{"GRAY8", 255, {{1, 1, 1}}},
+    video_format{"GRAY16_LE", 65535, {{1, 1, 1}}},
+    video_format{"I420", 255, {{1, 1, 1}, {2, 2, 1}, {2, 2, 1}}},
+    video_format{"RGBA", 255, {{1, 1, 4}}},
+    video_format{"I420_10LE", 1023, {{1, 1, 1}, {2, 2, 1}, {2, 2, 1}}}};
+
+//! @brief The filtering modes of the measurements.
+const std::array modes{
+    mode{"per-pixel", "shared-covariance=false", {100.F, 100.F, false}},
+    mode{"shared", "shared-covariance=true", {100.F, 100.F, true}},
+    mode{"fixed",
+         "precision=fixed",
+         {100.F, 100.F, true, precision::fixed},
+         1},
+    mode{"half", "precision=half", {100.F, 100.F, true, precision::half}, 1},
+    mode{"bfloat16",
+         "precision=bfloat16",
+         {100.F, 100.F, true, precision::bfloat},
+         6},
+    mode{"blocks-2x2", "granularity=2x2", {100.F, 100.F, true}, 0, 2},
+    mode{"blocks-4x4", "granularity=4x4", {100.F, 100.F, true}, 0, 4},
+    mode{"out-of-place", "", {100.F, 100.F, true}, 0, 1, true},
+    mode{"async", "async-depth=2", {100.F, 100.F, true}, 0, 1, false, true}};
+
+//! @brief The number of samples of a tile, the element default.
+constexpr std::size_t tile_samples{65536};
+
+//! @brief The widest frames of the pipelines, bounded by the test source.
+constexpr std::size_t maximum_pipeline_width{1920};
+
+//! @brief The number of unmeasured frames before a kernel measurement.
+constexpr std::size_t warmup_frames{2};
+
+//! @brief Returns frames of pseudo-random samples of the format.
+//!
+//! @details The samples are uniformly distributed, as the snow pattern of the
+//! test source, and reproducible from the seed. The first sample of each
+//! plane is the greatest value, for the edge of the range.
+template <typename Pixel>
+auto make_frames(const video_format &format, std::size_t width,
+                 std::size_t height, std::size_t count, unsigned seed)
+    -> frames<Pixel> {
+  std::minstd_rand generator{seed};
+  std::uniform_int_distribution<unsigned> distribution{0, format.maximum};
+  frames<Pixel> result;
+  result.samples.resize(count);
+  result.planes.resize(count);
+  for (std::size_t index{0}; index < count; ++index) {
+    for (const auto &geometry : format.planes) {
+      const auto plane_width{(width + geometry.horizontal - 1) /
+                             geometry.horizontal * geometry.components};
+      const auto plane_height{(height + geometry.vertical - 1) /
+                              geometry.vertical};
+      auto &samples{result.samples[index].emplace_back(plane_width *
+                                                       plane_height)};
+      std::generate(std::begin(samples), std::end(samples),
+                    [&generator, &distribution] {
+                      return static_cast<Pixel>(distribution(generator));
+                    });
+      samples.front() = static_cast<Pixel>(format.maximum);
+      result.planes[index].push_back(
+          plane<Pixel>{samples.data(), plane_width, plane_height, plane_width,
+                       static_cast<Pixel>(format.maximum)});
+    }
+  }
+  return result;
+}
+
+//! @brief Returns the nearest-rank percentile of the values, as the element
+//! statistics.
+auto percentile(std::vector<double> values, double rank) -> double {
+  return nearest_rank(std::begin(values), std::end(values), rank);
+}
+
+//! @brief Returns the number of bytes a filter reads and writes per sample.
+//!
+//! @details The sample is read and written back, as the estimate and the
+//! per-pixel uncertainty, if any, in their stored precision, shared by the
+//! samples of a block.
+template <typename Pixel>
+auto traffic(const pixel_kalman &filter) -> double {
+  const auto narrow{filter.fixed() || filter.reduced()};
+  std::size_t bytes{narrow ? 2 * sizeof(std::uint16_t)
+                           : 2 * sizeof(pixel_kalman::value_type)};
+  if (!filter.shared) {
+    bytes += filter.reduced() ? 2 * sizeof(std::uint16_t)
+                              : 2 * sizeof(pixel_kalman::value_type);
+  }
+  const auto block{filter.granularity * filter.granularity};
+  return static_cast<double>(2 * sizeof(Pixel)) +
+         static_cast<double>(bytes) / static_cast<double>(block);
+}
+
+//! @brief Measures the engine kernels filtering frames of the format.
+//!
+//! @details The frame is filtered in place, or out of place from another
+//! frame, repeatedly. The median duration of the frames is reported per pixel
+//! of the frame, and as the throughput of the samples and state.
+template <typename Pixel>
+auto measure_kernel(const video_format &format, std::size_t width,
+                    std::size_t height, const mode &kind, std::size_t threads,
+                    std::size_t count) -> kernel_result {
+  auto frame{make_frames<Pixel>(format, width, height, 1, 1)};
+  const auto input{make_frames<Pixel>(format, width, height, 1, 2)};
+  auto &planes{frame.planes.front()};
+  if (kind.out_of_place) {
+    for (std::size_t index{0}; index < planes.size(); ++index) {
+      planes[index].source = input.planes.front()[index].data;
+      planes[index].source_stride = input.planes.front()[index].stride;
+    }
+  }
+  worker_pool pool{threads};
+  std::vector<pixel_kalman> filters(planes.size());
+  double bytes{0};
+  for (std::size_t index{0}; index < planes.size(); ++index) {
+    filters[index].resize(planes[index].width, planes[index].height,
+                          tile_samples, format.planes[index].components,
+                          kind.granularity);
+    filters[index].initialize(planes[index], kind.configuration, pool);
+    bytes += static_cast<double>(planes[index].size()) *
+             traffic<Pixel>(filters[index]);
+  }
+
+  std::vector<double> durations;
+  for (std::size_t index{0}; index < warmup_frames + count; ++index) {
+    const auto start{clock::now()};
+    for (std::size_t component{0}; component < planes.size(); ++component) {
+      filters[component].update(planes[component], pool);
+    }
+    const std::chrono::duration<double, std::nano> duration{clock::now() -
+                                                            start};
+    if (index >= warmup_frames) {
+      durations.push_back(duration.count());
+    }
+  }
+
+  const auto median{percentile(durations, 50)};
+  return {format.name,
+          width,
+          height,
+          kind.name,
+          pool.size(),
+          median / static_cast<double>(width * height),
+          bytes / median};
+}
+
+//! @brief Returns the resident and peak resident set sizes, in KiB.
+//!
+//! @details Read from the process status where available, zero otherwise.
+auto resident_size() -> std::size_t {
+  std::ifstream status{"/proc/self/status"};
+  for (std::string line; std::getline(status, line);) {
+    if (line.starts_with("VmRSS:")) {
+      return std::stoul(line.substr(line.find_first_of("0123456789")));
+    }
+  }
+  return 0;
+}
+
+//! @brief Pipeline cleanup scope deleter.
+void gst_pipeline_destroy(GstElement *pipeline) {
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+
+//! @brief Appends the time of the probed buffer to the times of the data.
+auto stamp(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+    -> GstPadProbeReturn {
+  static_cast<void>(pad);
+  static_cast<void>(info);
+  static_cast<std::vector<clock::time_point> *>(data)->push_back(clock::now());
+  return GST_PAD_PROBE_OK;
+}
+
+//! @brief Holds a reference to the probed buffer until the next buffer, for
+//! the element to receive read-only buffers and filter them out of place.
+auto share(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+    -> GstPadProbeReturn {
+  static_cast<void>(pad);
+  gst_buffer_replace(static_cast<GstBuffer **>(data),
+                     GST_PAD_PROBE_INFO_BUFFER(info));
+  return GST_PAD_PROBE_OK;
+}
+
+//! @brief Declares the downstream support of the video metadata in the
+//! allocation queries, for the element to align the strides of its pool.
+auto support_video_meta(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+    -> GstPadProbeReturn {
+  static_cast<void>(pad);
+  static_cast<void>(data);
+  if (auto *query{GST_PAD_PROBE_INFO_QUERY(info)};
+      GST_QUERY_TYPE(query) == GST_QUERY_ALLOCATION) {
+    gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, nullptr);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+//! @brief Measures the element in a headless pipeline from a test source.
+//!
+//! @details The frames are generated as fast as possible and discarded
+//! without synchronization. The throughput is of the whole pipeline, from
+//! playing to end of stream. The latency of a buffer is from its arrival on
+//! the element sink pad to its departure from the source pad, buffers leaving
+//! in order. The resident size is sampled at end of stream. The buffers of the
+//! out of place modes are made read-only by holding a reference to each until
+//! the next, and the allocation queries declare the video metadata support,
+//! for the element to filter into its pooled output frames with aligned rows.
+auto measure_pipeline(const video_format &format, std::size_t width,
+                      std::size_t height, const mode &kind, std::size_t count)
+    -> pipeline_result {
+  pipeline_result result{format.name, width, height, kind.name};
+
+  std::ostringstream description;
+  description << "videotestsrc pattern=snow num-buffers=" << count
+              << " ! video/x-raw,format=" << format.name << ",width=" << width
+              << ",height=" << height
+              << ",framerate=30/1 ! kalman name=kalman p=100 r=100 "
+              << kind.properties << " ! fakesink sync=false";
+  GError *error{nullptr};
+  auto *const launched{gst_parse_launch(description.str().c_str(), &error)};
+  if (error != nullptr) {
+    std::cerr << "Failed to parse the pipeline: " << error->message << '\n';
+    g_error_free(error);
+  }
+  if (launched == nullptr) {
+    return result;
+  }
+  GstBuffer *shared{nullptr};
+  const sr::unique_resource held{&shared, [](GstBuffer **buffer) {
+                                   gst_buffer_replace(buffer, nullptr);
+                                 }};
+  const sr::unique_resource pipeline{launched, gst_pipeline_destroy};
+
+  std::vector<clock::time_point> arrivals;
+  std::vector<clock::time_point> departures;
+  const sr::unique_resource element{
+      gst_bin_get_by_name(GST_BIN(pipeline.get()), "kalman"),
+      gst_object_unref};
+  const sr::unique_resource sink_pad{
+      gst_element_get_static_pad(element.get(), "sink"), gst_object_unref};
+  const sr::unique_resource source_pad{
+      gst_element_get_static_pad(element.get(), "src"), gst_object_unref};
+  gst_pad_add_probe(sink_pad.get(), GST_PAD_PROBE_TYPE_BUFFER, stamp,
+                    &arrivals, nullptr);
+  gst_pad_add_probe(source_pad.get(), GST_PAD_PROBE_TYPE_BUFFER, stamp,
+                    &departures, nullptr);
+  if (kind.out_of_place) {
+    gst_pad_add_probe(sink_pad.get(), GST_PAD_PROBE_TYPE_BUFFER, share,
+                      &shared, nullptr);
+    gst_pad_add_probe(source_pad.get(),
+                      static_cast<GstPadProbeType>(
+                          GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM |
+                          GST_PAD_PROBE_TYPE_PUSH),
+                      support_video_meta, nullptr, nullptr);
+  }
+
+  const sr::unique_resource bus{gst_element_get_bus(pipeline.get()),
+                                gst_object_unref};
+  const auto start{clock::now()};
+  gst_element_set_state(pipeline.get(), GST_STATE_PLAYING);
+  const sr::unique_resource message{
+      gst_bus_timed_pop_filtered(
+          bus.get(), GST_CLOCK_TIME_NONE,
+          static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR)),
+      gst_message_unref};
+  const std::chrono::duration<double> elapsed{clock::now() - start};
+  result.rss_kib = resident_size();
+  if (GST_MESSAGE_TYPE(message.get()) != GST_MESSAGE_EOS) {
+    std::cerr << "Failed to run the pipeline: " << description.str() << '\n';
+    return result;
+  }
+
+  std::vector<double> latencies;
+  for (std::size_t index{0};
+       index < std::min(arrivals.size(), departures.size()); ++index) {
+    const std::chrono::duration<double, std::micro> latency{
+        departures[index] - arrivals[index]};
+    latencies.push_back(latency.count());
+  }
+  result.completed = departures.size() == count;
+  result.fps = static_cast<double>(departures.size()) / elapsed.count();
+  result.latency_p50_us = percentile(latencies, 50);
+  result.latency_p90_us = percentile(latencies, 90);
+  result.latency_p99_us = percentile(latencies, 99);
+  return result;
+}
+
+//! @brief Checks the engine against the general library filter, per sample.
+//!
+//! @details The frames are filtered by a library filter per sample, predicted
+//! then updated, and by the engine in batches of frames with the workers,
+//! one second apart, in place or out of place. The single precision estimates
+//! and the samples must be identical. The fixed-point and reduced precision
+//! samples must be within the tolerance of the mode, the samples wider than
+//! 10 bits compared in 10-bit code values. Returns the number of mismatching
+//! samples.
+template <typename Pixel>
+auto check(const video_format &format, const mode &kind,
+           const pixel_kalman::configuration &parameters, std::size_t threads,
+           std::size_t batch) -> std::size_t {
+  constexpr std::size_t width{37};
+  constexpr std::size_t height{23};
+  constexpr std::size_t count{9};
+  const auto measurements{
+      make_frames<Pixel>(format, width, height, count, 2)};
+  auto frame{make_frames<Pixel>(format, width, height, count, 2)};
+  worker_pool pool{threads};
+  std::size_t mismatches{0};
+  const int wider_bits{
+      std::max(0, static_cast<int>(std::bit_width(
+                      static_cast<unsigned>(format.maximum))) - 10)};
+
+  for (std::size_t index{0}; index < format.planes.size(); ++index) {
+    const auto &first{measurements.planes.front()[index]};
+    std::vector<kalman> references(first.size());
+    for (std::size_t sample{0}; sample < first.size(); ++sample) {
+      references[sample].x(static_cast<float>(first.data[sample]));
+      references[sample].p(parameters.p);
+      references[sample].r(parameters.r);
+      references[sample].q(parameters.q);
+    }
+
+    pixel_kalman filter;
+    filter.resize(first.width, first.height, 3 * first.width);
+    auto configuration{kind.configuration};
+    configuration.p = parameters.p;
+    configuration.r = parameters.r;
+    configuration.q = parameters.q;
+    filter.initialize(first, configuration, pool);
+
+    std::vector<plane<Pixel>> planes;
+    for (std::size_t image{1}; image < count; ++image) {
+      auto &samples{planes.emplace_back(frame.planes[image][index])};
+      if (kind.out_of_place) {
+        std::fill_n(samples.data, samples.size(), Pixel{0});
+        samples.source = measurements.planes[image][index].data;
+        samples.source_stride = samples.stride;
+      }
+    }
+    const std::vector<float> elapsed(batch, 1.F);
+    for (std::size_t image{0}; image < planes.size(); image += batch) {
+      const auto frames{std::min(batch, planes.size() - image)};
+      filter.update(std::span<const plane<Pixel>>{planes}.subspan(image,
+                                                                  frames),
+                    pool, resolution::full,
+                    std::span<const float>{elapsed}.first(frames));
+    }
+
+    for (std::size_t image{1}; image < count; ++image) {
+      const auto &measured{measurements.planes[image][index]};
+      const auto &filtered{frame.planes[image][index]};
+      for (std::size_t sample{0}; sample < measured.size(); ++sample) {
+        references[sample].predict();
+        references[sample].update(static_cast<float>(measured.data[sample]));
+        const auto expected{pixel_kalman::clamp(references[sample].x(),
+                                                measured.maximum)};
+        const auto difference{std::abs(int{filtered.data[sample]} -
+                                       int{expected})};
+        mismatches += (difference >> wider_bits) > kind.tolerance ? 1 : 0;
+      }
+    }
+
+    if (!filter.fixed() && !filter.reduced()) {
+      for (std::size_t sample{0}; sample < first.size(); ++sample) {
+        const float uncertainty{filter.shared ? filter.shared_p
+                                              : filter.p[sample]};
+        mismatches +=
+            std::bit_cast<std::uint32_t>(filter.x[sample]) !=
+                        std::bit_cast<std::uint32_t>(references[sample].x()) ||
+                    std::bit_cast<std::uint32_t>(uncertainty) !=
+                        std::bit_cast<std::uint32_t>(references[sample].p())
+                ? 1
+                : 0;
+      }
+    }
+  }
+  return mismatches;
+}
+
+//! @brief Runs the golden check of each format, mode, worker count, and
+//! batch size, for confident and uncertain initial estimates, and with
+//! process noise.
+auto check_golden() -> golden_result {
+  golden_result result;
+  const std::array parameters{
+      pixel_kalman::configuration{1.F, 4.F},
+      pixel_kalman::configuration{100.F, 100.F},
+      pixel_kalman::configuration{1.F, 4.F, true, precision::single, 0.25F}};
+  for (const auto &format : formats) {
+    for (const auto &kind : modes) {
+      if (kind.granularity != 1 || kind.pipeline_only) {
+        continue;
+      }
+      for (const auto &parameter : parameters) {
+        for (const std::size_t threads : {1, 3}) {
+          for (const std::size_t batch : {1, 4}) {
+            const auto mismatches{
+                format.maximum > 255
+                    ? check<std::uint16_t>(format, kind, parameter, threads,
+                                           batch)
+                    : check<std::uint8_t>(format, kind, parameter, threads,
+                                          batch)};
+            if (mismatches != 0) {
+              std::cerr << "Golden mismatch: " << format.name << ' '
+                        << kind.name << " p=" << parameter.p
+                        << " r=" << parameter.r << " q=" << parameter.q
+                        << " threads=" << threads
+                        << " batch=" << batch << ": " << mismatches << '\n';
+            }
+            result.mismatches += mismatches;
+            ++result.cases;
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+//! @brief Prints the usage and exits.
+[[noreturn]] void usage() {
+  std::cerr << "Usage: gstkalman_benchmark [--kernel] [--pipeline] "
+               "[--golden] [--frames=N] [--output=FILE]\n";
+  std::exit(EXIT_FAILURE);
+}
+
+//! @brief Parses the positive count of the text. Returns whether the whole
+//! text is a positive count.
+auto parse_count(std::string_view text, std::size_t &count) -> bool {
+  const auto *const last{text.data() + text.size()};
+  const auto [end, error]{std::from_chars(text.data(), last, count)};
+  return error == std::errc{} && end == last && count != 0;
+}
+
+//! @brief Parses the command line options.
+//!
+//! @details Runs all the benchmarks unless some are selected.
+auto parse(std::span<char *> arguments) -> options {
+  options result;
+  for (const std::string_view argument : arguments) {
+    if (argument == "--kernel") {
+      result.kernel = true;
+    } else if (argument == "--pipeline") {
+      result.pipeline = true;
+    } else if (argument == "--golden") {
+      result.golden = true;
+    } else if (argument.starts_with("--frames=")) {
+      if (!parse_count(argument.substr(9), result.frames)) {
+        usage();
+      }
+    } else if (argument.starts_with("--output=")) {
+      result.output = argument.substr(9);
+    } else {
+      usage();
+    }
+  }
+  if (!result.kernel && !result.pipeline && !result.golden) {
+    result.kernel = result.pipeline = result.golden = true;
+  }
+  return result;
+}
+
+//! @brief Writes the results of the benchmarks as JSON.
+void write(std::ostream &output, const std::vector<kernel_result> &kernels,
+           const std::vector<pipeline_result> &pipelines,
+           const golden_result *golden) {
+  output << "{\n  \"kernel\": [";
+  for (std::size_t index{0}; index < kernels.size(); ++index) {
+    const auto &result{kernels[index]};
+    output << (index == 0 ? "\n" : ",\n") << "    {\"format\": \""
+           << result.format << "\", \"width\": " << result.width
+           << ", \"height\": " << result.height << ", \"mode\": \""
+           << result.mode << "\", \"threads\": " << result.threads
+           << ", \"ns_per_pixel\": " << result.ns_per_pixel
+           << ", \"gb_per_second\": " << result.gb_per_second << '}';
+  }
+  output << "\n  ],\n  \"pipeline\": [";
+  for (std::size_t index{0}; index < pipelines.size(); ++index) {
+    const auto &result{pipelines[index]};
+    output << (index == 0 ? "\n" : ",\n") << "    {\"format\": \""
+           << result.format << "\", \"width\": " << result.width
+           << ", \"height\": " << result.height << ", \"mode\": \""
+           << result.mode << "\", \"completed\": " << std::boolalpha
+           << result.completed << ", \"fps\": " << result.fps
+           << ", \"latency_us\": {\"p50\": " << result.latency_p50_us
+           << ", \"p90\": " << result.latency_p90_us
+           << ", \"p99\": " << result.latency_p99_us
+           << "}, \"rss_kib\": " << result.rss_kib << '}';
+  }
+  output << "\n  ]";
+  if (golden != nullptr) {
+    output << ",\n  \"golden\": {\"cases\": " << golden->cases
+           << ", \"mismatches\": " << golden->mismatches
+           << ", \"passed\": " << std::boolalpha << (golden->mismatches == 0)
+           << '}';
+  }
+  output << "\n}\n";
+}
+
+//! @brief Runs the selected benchmarks and reports the results.
+//!
+//! @details Fails on golden mismatches and incomplete pipelines.
+auto run(const options &selection) -> int {
+  constexpr std::array resolutions{std::array<std::size_t, 2>{640, 480},
+                                   std::array<std::size_t, 2>{1920, 1080},
+                                   std::array<std::size_t, 2>{3840, 2160}};
+  const std::size_t hardware{std::max(1U, std::thread::hardware_concurrency())};
+  bool passed{true};
+
+  std::vector<kernel_result> kernels;
+  if (selection.kernel) {
+    for (const auto &[width, height] : resolutions) {
+      for (const auto &format : formats) {
+        for (const auto &kind : modes) {
+          if (kind.pipeline_only) {
+            continue;
+          }
+          for (const std::size_t threads : {std::size_t{1}, hardware}) {
+            kernels.push_back(
+                format.maximum > 255
+                    ? measure_kernel<std::uint16_t>(format, width, height,
+                                                    kind, threads,
+                                                    selection.frames)
+                    : measure_kernel<std::uint8_t>(format, width, height,
+                                                   kind, threads,
+                                                   selection.frames));
+            if (threads == hardware) {
+              break;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<pipeline_result> pipelines;
+  if (selection.pipeline) {
+    gst_init(nullptr, nullptr);
+    if (gst_plugin_load_file(GSTKALMAN_PLUGIN, nullptr) == nullptr) {
+      std::cerr << "Failed to load the plugin: " << GSTKALMAN_PLUGIN << '\n';
+      passed = false;
+    } else {
+      for (const auto &[width, height] : resolutions) {
+        if (width > maximum_pipeline_width) {
+          continue;
+        }
+        for (const auto &format : formats) {
+          for (const auto &kind : modes) {
+            pipelines.push_back(measure_pipeline(format, width, height, kind,
+                                                 10 * selection.frames));
+            passed = passed && pipelines.back().completed;
+          }
+        }
+      }
+    }
+  }
+
+  golden_result golden;
+  if (selection.golden) {
+    golden = check_golden();
+    passed = passed && golden.mismatches == 0;
+  }
+
+  if (selection.output.empty()) {
+    write(std::cout, kernels, pipelines,
+          selection.golden ? &golden : nullptr);
+  } else {
+    std::ofstream output{selection.output};
+    write(output, kernels, pipelines, selection.golden ? &golden : nullptr);
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+} // namespace fcarouge::benchmark
+
+//! @brief Entry point of the benchmarks.
+auto main(int argc, char *argv[]) -> int {
+  return fcarouge::benchmark::run(fcarouge::benchmark::parse(
+      std::span{argv, static_cast<std::size_t>(argc)}.subspan(1)));
+}
@@ -45,6 +45,7 @@ find_path(
 
 find_library(GSTREAMER_LIBRARY NAMES "gstreamer-1.0")
 find_library(GSTBASE_LIBRARY NAMES "gstbase-1.0")
+find_library(GSTVIDEO_LIBRARY NAMES "gstvideo-1.0")
 
 find_package_handle_standard_args(GStreamer DEFAULT_MSG GSTREAMER_LIBRARY
                                   GSTREAMER_INCLUDE)
@@ -52,3 +53,4 @@ find_package_handle_standard_args(GStreamer DEFAULT_MSG GSTREAMER_LIBRARY
 target_include_directories(gstkalman_gstreamer INTERFACE ${GSTREAMER_INCLUDE})
 target_link_libraries(gstkalman_gstreamer INTERFACE ${GSTREAMER_LIBRARY})
 target_link_libraries(gstkalman_gstreamer INTERFACE ${GSTBASE_LIBRARY})
+target_link_libraries(gstkalman_gstreamer INTERFACE ${GSTVIDEO_LIBRARY})
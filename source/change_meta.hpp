@@ -0,0 +1,102 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The change map metadata attached to the filtered frames.
+//!
+//! @details Downstream elements, encoders or analytics, may skip or cheapen
+//! the unchanged macroblocks of the frames. The metadata is looked up by the
+//! name of its registered API, without linking to the plugin.
+
+#ifndef FCAROUGE_CHANGE_META_HPP
+#define FCAROUGE_CHANGE_META_HPP
+
+#include <gst/gst.h>
+
+#include <string_view>
+
+//! @brief The name of the registered API of the change map metadata.
+inline constexpr std::string_view gst_kalman_change_meta_api_name{
+    "GstKalmanChangeMetaAPI"};
+
+//! @brief The change map of the macroblocks of a filtered frame.
+//!
+//! @details A macroblock changed when any of the samples of its first plane
+//! departed from their estimates by more than the change threshold. The bits
+//! of a row of macroblocks are packed from the least significant bit of the
+//! first byte of the row.
+struct GstKalmanChangeMeta {
+  //! @brief The parent metadata.
+  GstMeta meta;
+
+  //! @brief The width and height of a macroblock, in pixels.
+  guint macroblock_size;
+
+  //! @brief The number of macroblocks of a row of the frame.
+  guint columns;
+
+  //! @brief The number of rows of macroblocks of the frame.
+  guint rows;
+
+  //! @brief The number of bytes of a row of the map.
+  guint stride;
+
+  //! @brief The change bits of the macroblocks, row by row.
+  guint8 *map;
+};
+
+//! @brief Returns whether the macroblock of the change map changed.
+inline auto gst_kalman_change_meta_changed(const GstKalmanChangeMeta *meta,
+                                           guint column, guint row)
+    -> gboolean {
+  return (meta->map[row * meta->stride + column / 8] >> (column % 8)) & 1U;
+}
+
+//! @brief Returns the change map metadata of the buffer, if any.
+inline auto gst_buffer_get_kalman_change_meta(GstBuffer *buffer)
+    -> GstKalmanChangeMeta * {
+  const auto api{g_type_from_name(gst_kalman_change_meta_api_name.data())};
+  if (api == 0) {
+    return nullptr;
+  }
+
+  return reinterpret_cast<GstKalmanChangeMeta *>(
+      gst_buffer_get_meta(buffer, api));
+}
+
+#endif // FCAROUGE_CHANGE_META_HPP
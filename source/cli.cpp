@@ -0,0 +1,491 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The command line filter of raw video files, without GStreamer.
+//!
+//! @details Filters the frames of a raw planar or YUV4MPEG2 video file into a
+//! file of the same format, for batch processing of archives and to measure
+//! the filters without the pipeline overhead.
+
+#include "pixel_kalman.hpp"
+#include "snapshot.hpp"
+#include "video_kalman.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace fcarouge::cli {
+namespace {
+
+//! @brief The monotonic clock of the measurements.
+using clock = std::chrono::steady_clock;
+
+//! @brief The command line options.
+struct options {
+  //! @brief The path of the input file.
+  std::string input;
+
+  //! @brief The path of the output file.
+  std::string output;
+
+  //! @brief The format of the raw input, taken from the header of a
+  //! YUV4MPEG2 input.
+  std::optional<video_format> format;
+
+  //! @brief The number of pixels of a row of the raw input.
+  std::size_t width{0};
+
+  //! @brief The number of rows of the raw input.
+  std::size_t height{0};
+
+  //! @brief The number of frames per second of the raw input, zero for
+  //! unknown.
+  double rate{0};
+
+  //! @brief The configuration of the filters, as the element defaults.
+  pixel_kalman::configuration configuration{};
+
+  //! @brief The number of workers, zero for one per hardware thread.
+  std::size_t threads{0};
+
+  //! @brief The number of frames filtered together, tile by tile.
+  std::size_t batch{8};
+
+  //! @brief The number of pixels of the side of the square blocks of pixels
+  //! sharing a filter.
+  std::size_t granularity{1};
+};
+
+//! @brief The layout of the frames of the input file.
+struct stream {
+  //! @brief The format of the frames.
+  video_format format{video_format::i420};
+
+  //! @brief The number of pixels of a row.
+  std::size_t width{0};
+
+  //! @brief The number of rows.
+  std::size_t height{0};
+
+  //! @brief The number of frames per second, zero for unknown.
+  double rate{0};
+
+  //! @brief Whether the file is a YUV4MPEG2 stream, otherwise raw frames.
+  bool y4m{false};
+
+  //! @brief The number of bytes of the stream header, zero for raw frames.
+  std::size_t header{0};
+};
+
+//! @brief Prints the usage and exits.
+[[noreturn]] void usage() {
+  std::cerr << "Usage: gstkalman-cli [--format=FORMAT --width=W --height=H "
+               "[--framerate=N/D]] [--p=P] [--r=R] [--q=Q] "
+               "[--shared-covariance=true|false] "
+               "[--precision=float|fixed|half|bfloat16] [--n-threads=N] "
+               "[--batch=N] [--granularity=1|2|4] INPUT OUTPUT\n"
+               "The format of a raw input is one of GRAY8, GRAY16_LE, I420, "
+               "NV12, RGBA, BGRA, I420_10LE, I422_10LE, Y444_10LE. A .y4m "
+               "input is described by its header.\n";
+  std::exit(EXIT_FAILURE);
+}
+
+//! @brief Returns the number of the whole text, if valid.
+//!
+//! @details The real numbers are finite and nonnegative.
+template <typename Number>
+auto parse_number(std::string_view text) -> std::optional<Number> {
+  Number number{};
+  const auto *const last{text.data() + text.size()};
+  const auto [end, error]{std::from_chars(text.data(), last, number)};
+  if (error != std::errc{} || end != last) {
+    return std::nullopt;
+  }
+  if constexpr (std::is_floating_point_v<Number>) {
+    if (!std::isfinite(number) || number < 0) {
+      return std::nullopt;
+    }
+  }
+  return number;
+}
+
+//! @brief Returns the rate of the fraction, if valid with a nonzero
+//! denominator.
+auto parse_rate(std::string_view fraction, char separator)
+    -> std::optional<double> {
+  const auto split{fraction.find(separator)};
+  if (split == std::string_view::npos) {
+    return std::nullopt;
+  }
+  const auto numerator{
+      parse_number<std::uint64_t>(fraction.substr(0, split))};
+  const auto denominator{
+      parse_number<std::uint64_t>(fraction.substr(split + 1))};
+  if (!numerator || !denominator || *denominator == 0) {
+    return std::nullopt;
+  }
+  return static_cast<double>(*numerator) / static_cast<double>(*denominator);
+}
+
+//! @brief Parses the command line options.
+auto parse(std::span<char *> arguments) -> options {
+  options result;
+  std::vector<std::string_view> paths;
+  for (const std::string_view argument : arguments) {
+    const auto value{argument.substr(argument.find('=') + 1)};
+    const auto number{[value] {
+      const auto parsed{parse_number<std::size_t>(value)};
+      if (!parsed) {
+        usage();
+      }
+      return *parsed;
+    }};
+    const auto positive{[&number] {
+      const auto parsed{number()};
+      if (parsed == 0) {
+        usage();
+      }
+      return parsed;
+    }};
+    const auto real{[value] {
+      const auto parsed{parse_number<float>(value)};
+      if (!parsed) {
+        usage();
+      }
+      return *parsed;
+    }};
+    if (!argument.starts_with("--")) {
+      paths.push_back(argument);
+    } else if (argument.starts_with("--format=")) {
+      result.format = parse_format(value);
+      if (!result.format) {
+        usage();
+      }
+    } else if (argument.starts_with("--width=")) {
+      result.width = positive();
+    } else if (argument.starts_with("--height=")) {
+      result.height = positive();
+    } else if (argument.starts_with("--framerate=")) {
+      const auto rate{parse_rate(value, '/')};
+      if (!rate) {
+        usage();
+      }
+      result.rate = *rate;
+    } else if (argument.starts_with("--p=")) {
+      result.configuration.p = real();
+    } else if (argument.starts_with("--r=")) {
+      result.configuration.r = real();
+    } else if (argument.starts_with("--q=")) {
+      result.configuration.q = real();
+    } else if (argument.starts_with("--shared-covariance=")) {
+      result.configuration.shared = value != "false";
+    } else if (argument.starts_with("--precision=")) {
+      if (value == "float") {
+        result.configuration.estimate = precision::single;
+      } else if (value == "fixed") {
+        result.configuration.estimate = precision::fixed;
+      } else if (value == "half") {
+        result.configuration.estimate = precision::half;
+      } else if (value == "bfloat16") {
+        result.configuration.estimate = precision::bfloat;
+      } else {
+        usage();
+      }
+    } else if (argument.starts_with("--n-threads=")) {
+      result.threads = number();
+    } else if (argument.starts_with("--batch=")) {
+      result.batch = positive();
+    } else if (argument.starts_with("--granularity=")) {
+      result.granularity = number();
+      if (result.granularity != 1 && result.granularity != 2 &&
+          result.granularity != 4) {
+        usage();
+      }
+    } else {
+      usage();
+    }
+  }
+  if (paths.size() != 2) {
+    usage();
+  }
+  result.input = paths[0];
+  result.output = paths[1];
+  return result;
+}
+
+//! @brief Returns the format of the YUV4MPEG2 color space, if supported.
+auto y4m_format(std::string_view colorspace) -> std::optional<video_format> {
+  if (colorspace.starts_with("420p10")) {
+    return video_format::i420_10le;
+  }
+  if (colorspace.starts_with("420")) {
+    return video_format::i420;
+  }
+  if (colorspace == "422p10") {
+    return video_format::i422_10le;
+  }
+  if (colorspace == "444p10") {
+    return video_format::y444_10le;
+  }
+  if (colorspace == "mono") {
+    return video_format::gray8;
+  }
+  if (colorspace == "mono16") {
+    return video_format::gray16_le;
+  }
+  return std::nullopt;
+}
+
+//! @brief Describes the stream of the input bytes, from the YUV4MPEG2 header
+//! or the options of the raw frames.
+//!
+//! @details The YUV4MPEG2 streams default to the 4:2:0 color space, the
+//! interlacing, aspect ratio, and comment parameters are ignored. A malformed
+//! size or frame rate leaves the stream undescribed.
+auto describe(std::span<const std::byte> bytes, const options &selection)
+    -> std::optional<stream> {
+  constexpr std::string_view signature{"YUV4MPEG2 "};
+  const std::string_view text{reinterpret_cast<const char *>(bytes.data()),
+                              bytes.size()};
+  if (!text.starts_with(signature)) {
+    if (!selection.format || selection.width == 0 || selection.height == 0) {
+      return std::nullopt;
+    }
+    return stream{*selection.format, selection.width, selection.height,
+                  selection.rate};
+  }
+
+  const auto end{text.find('\n')};
+  if (end == std::string_view::npos) {
+    return std::nullopt;
+  }
+  stream result{video_format::i420, 0, 0, 0, true, end + 1};
+  auto parameters{text.substr(signature.size(), end - signature.size())};
+  while (!parameters.empty()) {
+    const auto next{parameters.find(' ')};
+    const auto parameter{parameters.substr(0, next)};
+    parameters = next == std::string_view::npos ? std::string_view{}
+                                                : parameters.substr(next + 1);
+    if (parameter.empty()) {
+      continue;
+    }
+    const auto value{parameter.substr(1)};
+    switch (parameter.front()) {
+    case 'W':
+      if (const auto width{parse_number<std::size_t>(value)}) {
+        result.width = *width;
+      } else {
+        return std::nullopt;
+      }
+      break;
+    case 'H':
+      if (const auto height{parse_number<std::size_t>(value)}) {
+        result.height = *height;
+      } else {
+        return std::nullopt;
+      }
+      break;
+    case 'F':
+      if (const auto rate{parse_rate(value, ':')}) {
+        result.rate = *rate;
+      } else {
+        return std::nullopt;
+      }
+      break;
+    case 'C':
+      if (const auto format{y4m_format(value)}) {
+        result.format = *format;
+      } else {
+        return std::nullopt;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  if (result.width == 0 || result.height == 0) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+//! @brief Returns the frame header and frame bytes at the offset of the
+//! stream, empty past the last whole frame.
+//!
+//! @details The frame header of a YUV4MPEG2 stream is kept as is, with its
+//! parameters, the raw frames have none.
+auto next_frame(std::span<const std::byte> bytes, std::size_t offset,
+                const stream &description, std::size_t size)
+    -> std::pair<std::span<const std::byte>, std::span<const std::byte>> {
+  std::size_t header{0};
+  if (description.y4m) {
+    const std::string_view text{
+        reinterpret_cast<const char *>(bytes.data()) + offset,
+        bytes.size() - offset};
+    const auto end{text.find('\n')};
+    if (!text.starts_with("FRAME") || end == std::string_view::npos) {
+      return {};
+    }
+    header = end + 1;
+  }
+  if (bytes.size() - offset < header + size) {
+    return {};
+  }
+  return {bytes.subspan(offset, header), bytes.subspan(offset + header, size)};
+}
+
+//! @brief Filters the frames of the input file into the output file and
+//! reports the throughput.
+//!
+//! @details The input file is memory-mapped and the frames are filtered out of
+//! place, by batches, from the mapping into a reused buffer written to the
+//! output file. The frames are predicted over their nominal duration, if
+//! known.
+auto run(const options &selection) -> int {
+  const mapped_file input{selection.input};
+  const auto bytes{input.bytes()};
+  if (bytes.empty()) {
+    std::cerr << "Failed to map the input: " << selection.input << '\n';
+    return EXIT_FAILURE;
+  }
+  const auto description{describe(bytes, selection)};
+  if (!description) {
+    std::cerr << "Unsupported or undescribed input: " << selection.input
+              << '\n';
+    usage();
+  }
+  std::ofstream output{selection.output, std::ios::binary};
+  if (!output) {
+    std::cerr << "Failed to open the output: " << selection.output << '\n';
+    return EXIT_FAILURE;
+  }
+
+  video_kalman filters{description->format,    description->width,
+                       description->height,    selection.configuration,
+                       selection.threads,      65536,
+                       selection.granularity};
+  const auto size{filters.frame_size()};
+  const auto batch{selection.batch};
+  std::vector<std::byte, aligned_allocator<std::byte>> buffer(batch * size);
+  std::vector<frame> outputs(batch);
+  std::vector<const_frame> inputs(batch);
+  std::vector<std::span<const std::byte>> headers(batch);
+  const std::vector<pixel_kalman::value_type> elapsed(
+      batch, description->rate > 0
+                 ? static_cast<pixel_kalman::value_type>(1 / description->rate)
+                 : 0.F);
+  output.write(reinterpret_cast<const char *>(bytes.data()),
+               static_cast<std::streamsize>(description->header));
+
+  const auto start{clock::now()};
+  clock::duration kernel{};
+  std::size_t offset{description->header};
+  std::size_t frames{0};
+  for (bool more{true}; more;) {
+    std::size_t count{0};
+    while (count < batch) {
+      const auto [header, samples]{
+          next_frame(bytes, offset, *description, size)};
+      if (samples.empty()) {
+        more = false;
+        break;
+      }
+      headers[count] = header;
+      inputs[count] = filters.packed(samples.data());
+      outputs[count] = filters.packed(buffer.data() + count * size);
+      offset += header.size() + samples.size();
+      ++count;
+    }
+
+    const auto filtering{clock::now()};
+    filters.filter(std::span{outputs}.first(count),
+                   std::span<const const_frame>{inputs}.first(count),
+                   std::span{elapsed}.first(count));
+    kernel += clock::now() - filtering;
+    for (std::size_t index{0}; index < count; ++index) {
+      output.write(reinterpret_cast<const char *>(headers[index].data()),
+                   static_cast<std::streamsize>(headers[index].size()));
+      output.write(reinterpret_cast<const char *>(outputs[index].data[0]),
+                   static_cast<std::streamsize>(size));
+    }
+    frames += count;
+  }
+  output.close();
+  if (!output) {
+    std::cerr << "Failed to write the output: " << selection.output << '\n';
+    return EXIT_FAILURE;
+  }
+  if (offset != bytes.size()) {
+    std::cerr << "Ignored the " << bytes.size() - offset
+              << " trailing bytes of a partial frame.\n";
+  }
+
+  const std::chrono::duration<double> total{clock::now() - start};
+  const std::chrono::duration<double> filtering{kernel};
+  std::cerr << "Filtered " << frames << " frames of " << description->width
+            << 'x' << description->height << ' '
+            << layout(description->format).name << " in " << total.count()
+            << " s: " << static_cast<double>(frames) / total.count()
+            << " frames per second, "
+            << static_cast<double>(frames) / filtering.count()
+            << " frames per second of filtering.\n";
+  return EXIT_SUCCESS;
+}
+
+} // namespace
+} // namespace fcarouge::cli
+
+//! @brief Entry point of the command line filter.
+auto main(int argc, char *argv[]) -> int {
+  return fcarouge::cli::run(fcarouge::cli::parse(
+      std::span{argv, static_cast<std::size_t>(argc)}.subspan(1)));
+}
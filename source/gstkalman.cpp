@@ -39,46 +39,282 @@ For more information, please refer to <https://unlicense.org> */
 //! @file
 //! @brief The GStreamer Kalman filter video plugin element implementation.
 
-#include <fcarouge/kalman.hpp>
+#include "change_meta.hpp"
+#include "gstkalman.hpp"
+#include "output_stage.hpp"
+#include "pixel_kalman.hpp"
+#include "snapshot.hpp"
+#include "statistics.hpp"
+#include "video_frame.hpp"
+#include "worker_pool.hpp"
+
 #include <glib-object.h>
-#include <gst/base/gstbasetransform.h>
 #include <gst/gst.h>
-#include <scope.h>
+#include <gst/video/gstvideofilter.h>
+#include <gst/video/gstvideopool.h>
+#include <gst/video/video.h>
 
 #include <algorithm>
-#include <execution>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
 #include <limits>
+#include <memory>
+#include <new>
 #include <span>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace {
 
-// A single precision, no input, constant system dynamic model Kalman filter.
-using kalman = fcarouge::kalman<float, float>;
+// Declares the debug categories of the element, of the frame mapping, and of
+// the filtering of the frames.
+GST_DEBUG_CATEGORY_STATIC(gst_kalman_debug);
+GST_DEBUG_CATEGORY_STATIC(gst_kalman_map_debug);
+GST_DEBUG_CATEGORY_STATIC(gst_kalman_kernel_debug);
+#define GST_CAT_DEFAULT gst_kalman_debug
+
+//! @brief The degradation levels of the filtering under load, each level
+//! including the lower levels.
+enum class degradation : gint {
+  //! @brief Every frame is fully filtered.
+  none,
+
+  //! @brief The filters share their estimate uncertainty and gain.
+  shared,
+
+  //! @brief The filters are updated by blocks of two by two pixels.
+  half,
+
+  //! @brief Every other frame passes the estimates through without update.
+  skip
+};
+
+//! @brief An input buffer queued for the output thread.
+struct queued_buffer {
+  //! @brief The input buffer.
+  GstBuffer *input{nullptr};
+
+  //! @brief The output buffer of the input filtered out of place, null to
+  //! filter the input in place.
+  GstBuffer *output{nullptr};
+};
+
+//! @brief The trace record of the timings of the filtered frames.
+//!
+//! @details Logged in the tracer category for the tracing tools to aggregate
+//! along the records of the core tracers.
+GstTracerRecord *frame_record{nullptr};
 
 //! @brief The GStreamer Kalman filter video plugin element datastructure.
 //!
 //! @details A GObject, GLib, GStreamer compatible element datastructure. The
 //! name `_GstKalman` conforms to the GObject framework naming expectations.
 struct _GstKalman {
-  //! @brief The transform base class providing default support.
-  GstBaseTransform element;
+  //! @brief The video filter base class providing default support.
+  GstVideoFilter element;
+
+  //! @brief The Kalman filters of the samples of each plane of the frame.
+  std::array<fcarouge::pixel_kalman, GST_VIDEO_MAX_PLANES> filters;
+
+  //! @brief The negotiated video information the filters are allocated for.
+  GstVideoInfo info;
 
-  //! @brief A Kalman filter for each pixel of the frame.
-  std::vector<kalman> filters;
+  //! @brief Whether the filters are initialized from the next frame.
+  bool reset{true};
 
   //! @brief The filter's initialization estimate uncertainty characteristics.
   float p{1.F};
 
   //! @brief The filter's initialization output uncertainty characteristics.
   float r{0.F};
+
+  //! @brief Whether the filters share their estimate uncertainty and gain.
+  bool shared_covariance{true};
+
+  //! @brief The requested representation of the filters' estimates.
+  fcarouge::precision precision{fcarouge::precision::single};
+
+  //! @brief The workers filtering the tiles of the planes, while started.
+  std::unique_ptr<fcarouge::worker_pool> pool;
+
+  //! @brief The number of workers, zero for one per hardware thread.
+  guint threads{0};
+
+  //! @brief The number of samples of a tile, rounded to whole rows.
+  guint tile_size{65536};
+
+  //! @brief The list of processors to pin the workers to, if any.
+  std::string processors;
+
+  //! @brief The number of frames filtered together, tile by tile.
+  guint batch{1};
+
+  //! @brief The mapped frames held for the next batch.
+  std::vector<GstVideoFrame> frames;
+
+  //! @brief The mapped input frames of the held frames filtered out of place,
+  //! unmapped for the held frames filtered in place.
+  std::vector<GstVideoFrame> inputs;
+
+  //! @brief The filtered buffers of the last batch pending output.
+  std::deque<GstBuffer *> outputs;
+
+  //! @brief Whether the frames are timed for the statistics.
+  bool collect_stats{false};
+
+  //! @brief The number of frames between statistics messages, zero for none.
+  guint stats_interval{0};
+
+  //! @brief The statistics of the filtered frames, guarded by the object lock.
+  fcarouge::statistics statistics;
+
+  //! @brief Whether the frames being filtered are timed.
+  bool timing{false};
+
+  //! @brief The duration of the last filtering, in nanoseconds.
+  GstClockTime kernel_time{0};
+
+  //! @brief The duration of the mapping of the held frames, in nanoseconds.
+  GstClockTime map_time{0};
+
+  //! @brief The greatest degradation level allowed under load.
+  degradation maximum_degradation{degradation::skip};
+
+  //! @brief The active degradation level.
+  degradation level{degradation::none};
+
+  //! @brief The number of frames filtered since the last level change.
+  guint level_frames{0};
+
+  //! @brief The last downstream processing proportion of the quality of
+  //! service, guarded by the object lock.
+  gdouble proportion{1.};
+
+  //! @brief The last downstream lateness of the quality of service, in
+  //! nanoseconds, guarded by the object lock.
+  GstClockTimeDiff jitter{0};
+
+  //! @brief Whether the next frame passes the estimates through.
+  bool skip{false};
+
+  //! @brief The greatest innovation of the samples of a skipped region, zero
+  //! to update every sample.
+  float change_threshold{0.F};
+
+  //! @brief The fraction of the samples updated by the last filtering.
+  double updated{1.};
+
+  //! @brief Whether the regions of the changed macroblocks are attached as
+  //! region of interest metadata.
+  bool roi_meta{false};
+
+  //! @brief Whether the change maps of the macroblocks are attached as
+  //! metadata.
+  bool change_meta{false};
+
+  //! @brief Whether each macroblock of each of the last filtered frames
+  //! changed, nonzero for a change.
+  std::vector<std::uint8_t> changes;
+
+  //! @brief The path prefix of the snapshot files of the filters, empty for
+  //! none.
+  std::string state_file;
+
+  //! @brief The number of frames between snapshots, zero for snapshots on
+  //! stop and renegotiation only.
+  guint snapshot_interval{0};
+
+  //! @brief The number of frames filtered since the last snapshot.
+  guint snapshot_frames{0};
+
+  //! @brief The background writer of the snapshots, while started with a
+  //! state file.
+  std::unique_ptr<fcarouge::snapshot_writer> writer;
+
+  //! @brief The number of pixels of the side of the square blocks of pixels
+  //! sharing a filter.
+  guint granularity{1};
+
+  //! @brief The process noise uncertainty per second of stream time.
+  float q{0.F};
+
+  //! @brief The number of frames per full update.
+  guint decimation{1};
+
+  //! @brief The presentation timestamp of the last filtered frame, if any.
+  GstClockTime timestamp{GST_CLOCK_TIME_NONE};
+
+  //! @brief The time elapsed since the last update, in seconds.
+  float elapsed{0.F};
+
+  //! @brief The number of frames passed through since the last update.
+  guint decimated{0};
+
+  //! @brief The number of frames queued for the output thread, zero to
+  //! filter on the streaming thread.
+  guint async_depth{0};
+
+  //! @brief The output thread filtering and pushing the queued buffers, while
+  //! started in the asynchronous mode.
+  std::unique_ptr<fcarouge::output_stage<queued_buffer>> stage;
+
+  //! @brief The last flow return of the output thread, returned upstream.
+  std::atomic<GstFlowReturn> status{GST_FLOW_OK};
 };
 
 //! @brief The GStreamer Kalman filter element properties.
 //!
 //! @todo Understand why GLib must have a zero-th property.
-enum property : guint { _, p, r };
+enum property : guint {
+  _,
+  p,
+  r,
+  shared_covariance,
+  precision,
+  threads,
+  tile_size,
+  processors,
+  batch,
+  stats,
+  collect_stats,
+  stats_interval,
+  max_degradation,
+  change_threshold,
+  roi_meta,
+  change_meta,
+  state_file,
+  snapshot_interval,
+  granularity,
+  q,
+  decimation,
+  async_depth
+};
+
+//! @brief The number of frames filtered at a level before degrading further.
+constexpr guint settle_frames{8};
+
+//! @brief The number of frames filtered at a level before recovering.
+constexpr guint recover_frames{60};
+
+//! @brief The downstream processing proportion under which to recover.
+constexpr gdouble recover_proportion{0.75};
+
+//! @brief The greatest number of frames of a batch.
+constexpr guint maximum_batch{64};
+
+//! @brief The greatest number of frames queued for the output thread.
+constexpr guint maximum_async_depth{64};
+
+//! @brief The alignment of the strides of the rows of the pooled frames, in
+//! bytes, for the rows to start on cache lines.
+constexpr guint stride_alignment{64};
+
+//! @brief The region of interest type of the changed macroblocks.
+constexpr std::string_view change_roi{"change"};
 
 constexpr std::string_view name{"kalman"};
 constexpr std::string_view classification{"Filter/Effect/Video"};
@@ -90,19 +326,63 @@ constexpr std::string_view author{
     "Francois Carouge <francois.carouge@gmail.com>"};
 constexpr std::string_view origin{
     "https://github.com/FrancoisCarouge/GstKalman"};
-constexpr std::string_view capabilities{"video/x-raw"};
+//! @todo Support the little endian formats on big endian hosts.
+constexpr std::string_view capabilities{
+    GST_VIDEO_CAPS_MAKE("{ GRAY8, GRAY16_LE, I420, NV12, RGBA, BGRA, "
+                        "I420_10LE, I422_10LE, Y444_10LE }")};
 
 // Declares the GstKalman element, a final class, part of the GStreamer module,
-// derived from the base transform element, and defines type support.
-G_DECLARE_FINAL_TYPE(GstKalman, gst_kalman, GST, KALMAN, GstBaseTransform)
-G_DEFINE_TYPE(GstKalman, gst_kalman, GST_TYPE_BASE_TRANSFORM);
+// derived from the video filter element, and defines type support.
+G_DECLARE_FINAL_TYPE(GstKalman, gst_kalman, GST, KALMAN, GstVideoFilter)
+G_DEFINE_TYPE(GstKalman, gst_kalman, GST_TYPE_VIDEO_FILTER);
 
 auto initialize(GstPlugin *plugin) -> gboolean;
+auto gst_kalman_degradation_get_type() -> GType;
+auto gst_kalman_change_meta_api_get_type() -> GType;
+auto gst_kalman_change_meta_get_info() -> const GstMetaInfo *;
+auto gst_kalman_change_meta_init(GstMeta *meta, gpointer parameters,
+                                 GstBuffer *buffer) -> gboolean;
+void gst_kalman_change_meta_free(GstMeta *meta, GstBuffer *buffer);
+auto gst_kalman_change_meta_transform(GstBuffer *destination, GstMeta *meta,
+                                      GstBuffer *buffer, GQuark type,
+                                      gpointer data) -> gboolean;
+auto structure(const fcarouge::statistics &statistics) -> GstStructure *;
 void gst_kalman_set_property(GObject *object, guint prop_id,
                              const GValue *value, GParamSpec *pspec);
 void gst_kalman_get_property(GObject *object, guint prop_id, GValue *value,
                              GParamSpec *pspec);
-auto gst_kalman_transform_in_place(GstBaseTransform *base, GstBuffer *output)
+void gst_kalman_finalize(GObject *object);
+void deliver(GstKalman *element, const queued_buffer &buffers);
+auto gst_kalman_start(GstBaseTransform *base) -> gboolean;
+auto gst_kalman_stop(GstBaseTransform *base) -> gboolean;
+auto gst_kalman_sink_event(GstBaseTransform *base, GstEvent *event)
+    -> gboolean;
+auto gst_kalman_src_event(GstBaseTransform *base, GstEvent *event)
+    -> gboolean;
+auto gst_kalman_query(GstBaseTransform *base, GstPadDirection direction,
+                      GstQuery *query) -> gboolean;
+auto gst_kalman_propose_allocation(GstBaseTransform *base,
+                                   GstQuery *decide_query, GstQuery *query)
+    -> gboolean;
+auto gst_kalman_decide_allocation(GstBaseTransform *base, GstQuery *query)
+    -> gboolean;
+auto gst_kalman_prepare_output_buffer(GstBaseTransform *base,
+                                      GstBuffer *input, GstBuffer **output)
+    -> GstFlowReturn;
+auto gst_kalman_generate_output(GstBaseTransform *base, GstBuffer **output)
+    -> GstFlowReturn;
+auto gst_kalman_transform(GstBaseTransform *base, GstBuffer *input,
+                          GstBuffer *output) -> GstFlowReturn;
+auto gst_kalman_transform_in_place(GstBaseTransform *base, GstBuffer *buffer)
+    -> GstFlowReturn;
+auto gst_kalman_set_info(GstVideoFilter *base, GstCaps *input_capabilities,
+                         GstVideoInfo *input_information,
+                         GstCaps *output_capabilities,
+                         GstVideoInfo *output_information) -> gboolean;
+auto gst_kalman_transform_frame(GstVideoFilter *base, GstVideoFrame *input,
+                                GstVideoFrame *output) -> GstFlowReturn;
+auto gst_kalman_transform_frame_in_place(GstVideoFilter *base,
+                                         GstVideoFrame *frame)
     -> GstFlowReturn;
 
 // Defines and exports the entry point and metadata of the plugin.
@@ -112,9 +392,110 @@ GST_PLUGIN_DEFINE(GST_VERSION_MAJOR, GST_VERSION_MINOR, kalman,
 GST_ELEMENT_REGISTER_DEFINE(kalman, name.data(), GST_RANK_NONE,
                             gst_kalman_get_type());
 
-//! @brief Registers the plugin element.
+//! @brief Registers the plugin elements.
 auto initialize(GstPlugin *plugin) -> gboolean {
-  return GST_ELEMENT_REGISTER(kalman, plugin);
+  return GST_ELEMENT_REGISTER(kalman, plugin) &&
+         GST_ELEMENT_REGISTER(multikalman, plugin);
+}
+
+//! @brief Registers and provides the degradation enumeration type.
+auto gst_kalman_degradation_get_type() -> GType {
+  static const GType type{[] {
+    static constexpr std::array values{
+        GEnumValue{static_cast<gint>(degradation::none),
+                   "Fully filter every frame", "none"},
+        GEnumValue{static_cast<gint>(degradation::shared),
+                   "Share the estimate uncertainty and gain", "shared-gain"},
+        GEnumValue{static_cast<gint>(degradation::half),
+                   "Also update by blocks of two by two pixels",
+                   "half-resolution"},
+        GEnumValue{static_cast<gint>(degradation::skip),
+                   "Also pass every other frame through", "skip-frames"},
+        GEnumValue{0, nullptr, nullptr}};
+    return g_enum_register_static("GstKalmanDegradation", values.data());
+  }()};
+  return type;
+}
+
+//! @brief Registers and provides the change map metadata API type.
+auto gst_kalman_change_meta_api_get_type() -> GType {
+  static const GType type{[] {
+    static std::array<const gchar *, 2> tags{GST_META_TAG_VIDEO_STR, nullptr};
+    return gst_meta_api_type_register(gst_kalman_change_meta_api_name.data(),
+                                      tags.data());
+  }()};
+  return type;
+}
+
+//! @brief Registers and provides the change map metadata implementation.
+auto gst_kalman_change_meta_get_info() -> const GstMetaInfo * {
+  static const GstMetaInfo *const information{gst_meta_register(
+      gst_kalman_change_meta_api_get_type(), "GstKalmanChangeMeta",
+      sizeof(GstKalmanChangeMeta), gst_kalman_change_meta_init,
+      gst_kalman_change_meta_free, gst_kalman_change_meta_transform)};
+  return information;
+}
+
+//! @brief Initializes an empty change map.
+auto gst_kalman_change_meta_init(GstMeta *meta, gpointer parameters,
+                                 GstBuffer *buffer) -> gboolean {
+  static_cast<void>(parameters);
+  static_cast<void>(buffer);
+
+  auto *change{reinterpret_cast<GstKalmanChangeMeta *>(meta)};
+  change->macroblock_size = 0;
+  change->columns = 0;
+  change->rows = 0;
+  change->stride = 0;
+  change->map = nullptr;
+
+  return true;
+}
+
+//! @brief Releases the bits of the change map.
+void gst_kalman_change_meta_free(GstMeta *meta, GstBuffer *buffer) {
+  static_cast<void>(buffer);
+
+  g_free(reinterpret_cast<GstKalmanChangeMeta *>(meta)->map);
+}
+
+//! @brief Attaches a cleared change map of the macroblocks to the buffer.
+auto add_change_meta(GstBuffer *buffer, guint macroblock_size, guint columns,
+                     guint rows) -> GstKalmanChangeMeta * {
+  auto *meta{reinterpret_cast<GstKalmanChangeMeta *>(gst_buffer_add_meta(
+      buffer, gst_kalman_change_meta_get_info(), nullptr))};
+  meta->macroblock_size = macroblock_size;
+  meta->columns = columns;
+  meta->rows = rows;
+  meta->stride = (columns + 7) / 8;
+  meta->map = static_cast<guint8 *>(g_malloc0(meta->stride * rows));
+
+  return meta;
+}
+
+//! @brief Copies the change map along whole buffer copies.
+//!
+//! @details The map of a copy of a region of the buffer is not copied. The
+//! other transformations, scaling included, are not supported.
+auto gst_kalman_change_meta_transform(GstBuffer *destination, GstMeta *meta,
+                                      GstBuffer *buffer, GQuark type,
+                                      gpointer data) -> gboolean {
+  static_cast<void>(buffer);
+
+  if (!GST_META_TRANSFORM_IS_COPY(type)) {
+    return false;
+  }
+
+  if (static_cast<GstMetaTransformCopy *>(data)->region) {
+    return true;
+  }
+
+  const auto *source{reinterpret_cast<GstKalmanChangeMeta *>(meta)};
+  auto *copy{add_change_meta(destination, source->macroblock_size,
+                             source->columns, source->rows)};
+  std::copy_n(source->map, source->stride * source->rows, copy->map);
+
+  return true;
 }
 
 //! @brief Defines the element details.
@@ -125,6 +506,7 @@ void gst_kalman_class_init(GstKalmanClass *klass) {
   auto *object_klass{G_OBJECT_CLASS(klass)};
   object_klass->set_property = gst_kalman_set_property;
   object_klass->get_property = gst_kalman_get_property;
+  object_klass->finalize = gst_kalman_finalize;
 
   constexpr GParamFlags described_readwrite{
       static_cast<GParamFlags>(static_cast<unsigned>(G_PARAM_READWRITE) |
@@ -138,6 +520,171 @@ void gst_kalman_class_init(GstKalmanClass *klass) {
       object_klass, property::r,
       g_param_spec_float("r", "R", "Initialize output uncertainty.", 0.,
                          max_float, 0., described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::shared_covariance,
+      g_param_spec_boolean(
+          "shared-covariance", "Shared Covariance",
+          "Advance one estimate uncertainty and gain per frame for all pixels.",
+          true, described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::precision,
+      g_param_spec_enum("precision", "Precision",
+                        "Representation of the estimates.",
+                        gst_kalman_precision_get_type(),
+                        static_cast<gint>(fcarouge::precision::single),
+                        described_readwrite));
+  constexpr GParamFlags described_readwrite_ready{static_cast<GParamFlags>(
+      static_cast<unsigned>(described_readwrite) |
+      static_cast<unsigned>(GST_PARAM_MUTABLE_READY))};
+  g_object_class_install_property(
+      object_klass, property::threads,
+      g_param_spec_uint("n-threads", "Threads",
+                        "Number of workers, 0 for one per hardware thread.", 0,
+                        std::numeric_limits<guint>::max(), 0,
+                        described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::tile_size,
+      g_param_spec_uint("tile-size", "Tile Size",
+                        "Number of samples of a tile of work, in whole rows.",
+                        1, std::numeric_limits<guint>::max(), 65536,
+                        described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::processors,
+      g_param_spec_string("cpus", "CPUs",
+                          "Processors to pin the workers to, for example "
+                          "\"0,2-5\", empty for no pinning.",
+                          "", described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::batch,
+      g_param_spec_uint("batch", "Batch",
+                        "Number of frames held and filtered together, tile by "
+                        "tile, for throughput at the cost of latency.",
+                        1, maximum_batch, 1, described_readwrite_ready));
+  constexpr GParamFlags described_readable{
+      static_cast<GParamFlags>(static_cast<unsigned>(G_PARAM_READABLE) |
+                               static_cast<unsigned>(G_PARAM_STATIC_STRINGS))};
+  g_object_class_install_property(
+      object_klass, property::stats,
+      g_param_spec_boxed("stats", "Statistics",
+                         "Frame and reinitialization counts, and rolling "
+                         "percentiles of the kernel time, map time, in "
+                         "nanoseconds, and worker imbalance.",
+                         GST_TYPE_STRUCTURE, described_readable));
+  g_object_class_install_property(
+      object_klass, property::collect_stats,
+      g_param_spec_boolean("collect-stats", "Collect Statistics",
+                           "Time the frames for the statistics.", false,
+                           described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::stats_interval,
+      g_param_spec_uint("stats-interval", "Statistics Interval",
+                        "Number of collected frames between statistics "
+                        "element messages, 0 for none.",
+                        0, std::numeric_limits<guint>::max(), 0,
+                        described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::max_degradation,
+      g_param_spec_enum("max-degradation", "Maximum Degradation",
+                        "Greatest degradation level of the filtering when "
+                        "late, with quality of service enabled.",
+                        gst_kalman_degradation_get_type(),
+                        static_cast<gint>(degradation::skip),
+                        described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::change_threshold,
+      g_param_spec_float("change-threshold", "Change Threshold",
+                         "Skip the regions of converged filters whose samples "
+                         "all stay within this distance of their estimates, "
+                         "0 to update every sample.",
+                         0., max_float, 0., described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::roi_meta,
+      g_param_spec_boolean("roi-meta", "Region of Interest Metadata",
+                           "Attach the regions of the changed macroblocks as "
+                           "region of interest metadata.",
+                           false, described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::change_meta,
+      g_param_spec_boolean("change-meta", "Change Metadata",
+                           "Attach the change map of the macroblocks as "
+                           "metadata.",
+                           false, described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::state_file,
+      g_param_spec_string("state-file", "State File",
+                          "Path prefix of the snapshot files of the filters, "
+                          "suffixed with the format and resolution, empty "
+                          "for none.",
+                          "", described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::snapshot_interval,
+      g_param_spec_uint("snapshot-interval", "Snapshot Interval",
+                        "Number of filtered frames between snapshots of the "
+                        "filters, 0 for snapshots on stop and renegotiation "
+                        "only.",
+                        0, std::numeric_limits<guint>::max(), 0,
+                        described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::granularity,
+      g_param_spec_enum("granularity", "Granularity",
+                        "Square blocks of pixels sharing a filter, updated "
+                        "with the mean of their samples.",
+                        gst_kalman_granularity_get_type(), 1,
+                        described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::q,
+      g_param_spec_float("q", "Q",
+                         "Process noise uncertainty per second of stream "
+                         "time.",
+                         0.F, std::numeric_limits<float>::max(), 0.F,
+                         described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::decimation,
+      g_param_spec_uint("decimation", "Decimation",
+                        "Number of frames per full update, the others "
+                        "passing the predicted estimates through.",
+                        1, std::numeric_limits<guint>::max(), 1,
+                        described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::async_depth,
+      g_param_spec_uint("async-depth", "Asynchronous Depth",
+                        "Number of frames queued for a dedicated output "
+                        "thread filtering and pushing them, 0 to filter on "
+                        "the streaming thread.",
+                        0, maximum_async_depth, 0,
+                        described_readwrite_ready));
+
+  GST_DEBUG_CATEGORY_INIT(gst_kalman_debug, "kalman", 0,
+                          "Kalman filter element");
+  GST_DEBUG_CATEGORY_INIT(gst_kalman_map_debug, "kalman-map", 0,
+                          "Kalman filter element frame mapping");
+  GST_DEBUG_CATEGORY_INIT(gst_kalman_kernel_debug, "kalman-kernel", 0,
+                          "Kalman filter element frame filtering");
+  frame_record = gst_tracer_record_new(
+      "kalman-frame.class", "element", GST_TYPE_STRUCTURE,
+      gst_structure_new("value", "type", G_TYPE_GTYPE, G_TYPE_STRING,
+                        "description", G_TYPE_STRING, "The element name",
+                        nullptr),
+      "frames", GST_TYPE_STRUCTURE,
+      gst_structure_new("value", "type", G_TYPE_GTYPE, G_TYPE_UINT,
+                        "description", G_TYPE_STRING,
+                        "The number of frames filtered together", nullptr),
+      "kernel", GST_TYPE_STRUCTURE,
+      gst_structure_new("value", "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+                        "description", G_TYPE_STRING,
+                        "The filtering time of the frames, in nanoseconds",
+                        nullptr),
+      "map", GST_TYPE_STRUCTURE,
+      gst_structure_new("value", "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+                        "description", G_TYPE_STRING,
+                        "The mapping time of the frames, in nanoseconds",
+                        nullptr),
+      "imbalance", GST_TYPE_STRUCTURE,
+      gst_structure_new("value", "type", G_TYPE_GTYPE, G_TYPE_DOUBLE,
+                        "description", G_TYPE_STRING,
+                        "The busiest to mean worker time ratio", nullptr),
+      nullptr);
+  GST_OBJECT_FLAG_SET(frame_record, GST_OBJECT_FLAG_MAY_BE_LEAKED);
 
   auto *gstelement_klass{GST_ELEMENT_CLASS(klass)};
   gst_element_class_set_static_metadata(gstelement_klass, long_name.data(),
@@ -156,8 +703,31 @@ void gst_kalman_class_init(GstKalmanClass *klass) {
   gst_element_class_add_pad_template(
       gstelement_klass, gst_static_pad_template_get(&source_template));
 
-  GST_BASE_TRANSFORM_CLASS(klass)->transform_ip =
+  auto *base_transform_klass{GST_BASE_TRANSFORM_CLASS(klass)};
+  base_transform_klass->start = GST_DEBUG_FUNCPTR(gst_kalman_start);
+  base_transform_klass->stop = GST_DEBUG_FUNCPTR(gst_kalman_stop);
+  base_transform_klass->sink_event = GST_DEBUG_FUNCPTR(gst_kalman_sink_event);
+  base_transform_klass->src_event = GST_DEBUG_FUNCPTR(gst_kalman_src_event);
+  base_transform_klass->query = GST_DEBUG_FUNCPTR(gst_kalman_query);
+  base_transform_klass->propose_allocation =
+      GST_DEBUG_FUNCPTR(gst_kalman_propose_allocation);
+  base_transform_klass->decide_allocation =
+      GST_DEBUG_FUNCPTR(gst_kalman_decide_allocation);
+  base_transform_klass->prepare_output_buffer =
+      GST_DEBUG_FUNCPTR(gst_kalman_prepare_output_buffer);
+  base_transform_klass->generate_output =
+      GST_DEBUG_FUNCPTR(gst_kalman_generate_output);
+  base_transform_klass->transform = GST_DEBUG_FUNCPTR(gst_kalman_transform);
+  base_transform_klass->transform_ip =
       GST_DEBUG_FUNCPTR(gst_kalman_transform_in_place);
+
+  // The frames are filtered in place or out of place, buffer by buffer.
+  auto *video_filter_klass{GST_VIDEO_FILTER_CLASS(klass)};
+  video_filter_klass->set_info = GST_DEBUG_FUNCPTR(gst_kalman_set_info);
+  video_filter_klass->transform_frame =
+      GST_DEBUG_FUNCPTR(gst_kalman_transform_frame);
+  video_filter_klass->transform_frame_ip =
+      GST_DEBUG_FUNCPTR(gst_kalman_transform_frame_in_place);
 }
 
 //! @brief Update the element instance data on property change.
@@ -172,6 +742,66 @@ void gst_kalman_set_property(GObject *object, guint prop_id,
   case property::r:
     element->r = g_value_get_float(value);
     break;
+  case property::shared_covariance:
+    element->shared_covariance = g_value_get_boolean(value) != 0;
+    break;
+  case property::precision:
+    element->precision =
+        static_cast<fcarouge::precision>(g_value_get_enum(value));
+    break;
+  case property::threads:
+    element->threads = g_value_get_uint(value);
+    break;
+  case property::tile_size:
+    element->tile_size = g_value_get_uint(value);
+    break;
+  case property::processors: {
+    const auto *list{g_value_get_string(value)};
+    element->processors = list != nullptr ? list : "";
+    break;
+  }
+  case property::batch:
+    element->batch = g_value_get_uint(value);
+    break;
+  case property::collect_stats:
+    element->collect_stats = g_value_get_boolean(value) != 0;
+    break;
+  case property::stats_interval:
+    element->stats_interval = g_value_get_uint(value);
+    break;
+  case property::max_degradation:
+    element->maximum_degradation =
+        static_cast<degradation>(g_value_get_enum(value));
+    break;
+  case property::change_threshold:
+    element->change_threshold = g_value_get_float(value);
+    break;
+  case property::roi_meta:
+    element->roi_meta = g_value_get_boolean(value);
+    break;
+  case property::change_meta:
+    element->change_meta = g_value_get_boolean(value);
+    break;
+  case property::state_file: {
+    const auto *path{g_value_get_string(value)};
+    element->state_file = path != nullptr ? path : "";
+    break;
+  }
+  case property::snapshot_interval:
+    element->snapshot_interval = g_value_get_uint(value);
+    break;
+  case property::granularity:
+    element->granularity = static_cast<guint>(g_value_get_enum(value));
+    break;
+  case property::q:
+    element->q = g_value_get_float(value);
+    break;
+  case property::decimation:
+    element->decimation = g_value_get_uint(value);
+    break;
+  case property::async_depth:
+    element->async_depth = g_value_get_uint(value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
     break;
@@ -179,93 +809,1305 @@ void gst_kalman_set_property(GObject *object, guint prop_id,
 }
 
 //! @brief Provides the element instance data on property request.
-//!
-//! @todo Implement and test.
 void gst_kalman_get_property(GObject *object, guint prop_id, GValue *value,
                              GParamSpec *pspec) {
-  static_cast<void>(object);
-  static_cast<void>(prop_id);
-  static_cast<void>(value);
   static_cast<void>(pspec);
+
+  switch (const auto *element{GST_KALMAN(object)}; prop_id) {
+  case property::p:
+    g_value_set_float(value, element->p);
+    break;
+  case property::r:
+    g_value_set_float(value, element->r);
+    break;
+  case property::shared_covariance:
+    g_value_set_boolean(value,
+                        static_cast<gboolean>(element->shared_covariance));
+    break;
+  case property::precision:
+    g_value_set_enum(value, static_cast<gint>(element->precision));
+    break;
+  case property::threads:
+    g_value_set_uint(value, element->threads);
+    break;
+  case property::tile_size:
+    g_value_set_uint(value, element->tile_size);
+    break;
+  case property::processors:
+    g_value_set_string(value, element->processors.c_str());
+    break;
+  case property::batch:
+    g_value_set_uint(value, element->batch);
+    break;
+  case property::stats:
+    GST_OBJECT_LOCK(object);
+    g_value_take_boxed(value, structure(element->statistics));
+    GST_OBJECT_UNLOCK(object);
+    break;
+  case property::collect_stats:
+    g_value_set_boolean(value, static_cast<gboolean>(element->collect_stats));
+    break;
+  case property::stats_interval:
+    g_value_set_uint(value, element->stats_interval);
+    break;
+  case property::max_degradation:
+    g_value_set_enum(value, static_cast<gint>(element->maximum_degradation));
+    break;
+  case property::change_threshold:
+    g_value_set_float(value, element->change_threshold);
+    break;
+  case property::roi_meta:
+    g_value_set_boolean(value, element->roi_meta);
+    break;
+  case property::change_meta:
+    g_value_set_boolean(value, element->change_meta);
+    break;
+  case property::state_file:
+    g_value_set_string(value, element->state_file.c_str());
+    break;
+  case property::snapshot_interval:
+    g_value_set_uint(value, element->snapshot_interval);
+    break;
+  case property::granularity:
+    g_value_set_enum(value, static_cast<gint>(element->granularity));
+    break;
+  case property::q:
+    g_value_set_float(value, element->q);
+    break;
+  case property::decimation:
+    g_value_set_uint(value, element->decimation);
+    break;
+  case property::async_depth:
+    g_value_set_uint(value, element->async_depth);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    break;
+  }
 }
 
 //! @brief Instantiates the element.
 //!
-//! @details Nothing to do for now.
-void gst_kalman_init(GstKalman *element) { static_cast<void>(element); }
+//! @details The GObject instance storage is zero-initialized, not constructed.
+//! The C++ members are constructed in place for their default member
+//! initializers to apply. The quality of service is enabled.
+void gst_kalman_init(GstKalman *element) {
+  new (&element->filters) decltype(element->filters){};
+  gst_video_info_init(&element->info);
+  new (&element->reset) bool{true};
+  new (&element->p) float{1.F};
+  new (&element->r) float{0.F};
+  new (&element->shared_covariance) bool{true};
+  new (&element->precision) fcarouge::precision{fcarouge::precision::single};
+  new (&element->pool) std::unique_ptr<fcarouge::worker_pool>{};
+  new (&element->threads) guint{0};
+  new (&element->tile_size) guint{65536};
+  new (&element->processors) std::string{};
+  new (&element->batch) guint{1};
+  new (&element->frames) std::vector<GstVideoFrame>{};
+  new (&element->inputs) std::vector<GstVideoFrame>{};
+  new (&element->outputs) std::deque<GstBuffer *>{};
+  new (&element->collect_stats) bool{false};
+  new (&element->stats_interval) guint{0};
+  new (&element->statistics) fcarouge::statistics{};
+  new (&element->timing) bool{false};
+  new (&element->kernel_time) GstClockTime{0};
+  new (&element->map_time) GstClockTime{0};
+  new (&element->maximum_degradation) degradation{degradation::skip};
+  new (&element->level) degradation{degradation::none};
+  new (&element->level_frames) guint{0};
+  new (&element->proportion) gdouble{1.};
+  new (&element->jitter) GstClockTimeDiff{0};
+  new (&element->skip) bool{false};
+  new (&element->change_threshold) float{0.F};
+  new (&element->updated) double{1.};
+  new (&element->roi_meta) bool{false};
+  new (&element->change_meta) bool{false};
+  new (&element->changes) std::vector<std::uint8_t>{};
+  new (&element->state_file) std::string{};
+  new (&element->snapshot_interval) guint{0};
+  new (&element->snapshot_frames) guint{0};
+  new (&element->writer) std::unique_ptr<fcarouge::snapshot_writer>{};
+  new (&element->granularity) guint{1};
+  new (&element->q) float{0.F};
+  new (&element->decimation) guint{1};
+  new (&element->timestamp) GstClockTime{GST_CLOCK_TIME_NONE};
+  new (&element->elapsed) float{0.F};
+  new (&element->decimated) guint{0};
+  new (&element->async_depth) guint{0};
+  new (&element->stage)
+      std::unique_ptr<fcarouge::output_stage<queued_buffer>>{};
+  new (&element->status) std::atomic<GstFlowReturn>{GST_FLOW_OK};
+  gst_base_transform_set_qos_enabled(GST_BASE_TRANSFORM(element), true);
+}
 
-//! @brief Processes the data buffer in-place.
+//! @brief Destroys the element.
 //!
-//! @details Filters the frame pixels. Reset and reinitialize the filters on
-//! resolution change.
-auto gst_kalman_transform_in_place(GstBaseTransform *element_base,
-                                   GstBuffer *output) -> GstFlowReturn {
+//! @details Destroys the C++ members constructed in place on instantiation
+//! before chaining up to the parent class.
+void gst_kalman_finalize(GObject *object) {
+  auto *element{GST_KALMAN(object)};
+  std::destroy_at(&element->status);
+  std::destroy_at(&element->stage);
+  std::destroy_at(&element->writer);
+  std::destroy_at(&element->state_file);
+  std::destroy_at(&element->statistics);
+  std::destroy_at(&element->changes);
+  std::destroy_at(&element->outputs);
+  std::destroy_at(&element->inputs);
+  std::destroy_at(&element->frames);
+  std::destroy_at(&element->processors);
+  std::destroy_at(&element->pool);
+  std::destroy_at(&element->filters);
+
+  G_OBJECT_CLASS(gst_kalman_parent_class)->finalize(object);
+}
+
+//! @brief Starts the workers, and the output thread in the asynchronous
+//! mode, on the element start.
+//!
+//! @details Fails on an invalid processors list.
+auto gst_kalman_start(GstBaseTransform *element_base) -> gboolean {
+  auto *element{GST_KALMAN(element_base)};
+  const auto processors{fcarouge::parse_processors(element->processors)};
+  if (!processors) {
+    GST_ELEMENT_ERROR(element, RESOURCE, SETTINGS,
+                      ("Invalid processors list \"%s\".",
+                       element->processors.c_str()),
+                      (nullptr));
+    return false;
+  }
+
+  element->pool =
+      std::make_unique<fcarouge::worker_pool>(element->threads, *processors);
+  element->status = GST_FLOW_OK;
+  if (element->async_depth != 0) {
+    element->stage = std::make_unique<fcarouge::output_stage<queued_buffer>>(
+        element->async_depth,
+        [element](const queued_buffer &buffers) { deliver(element, buffers); });
+  }
+  if (!element->state_file.empty()) {
+    element->writer = std::make_unique<fcarouge::snapshot_writer>();
+  }
+  element->snapshot_frames = 0;
+  GST_OBJECT_LOCK(element);
+  element->statistics = {};
+  element->proportion = 1.;
+  element->jitter = 0;
+  GST_OBJECT_UNLOCK(element);
+  element->level = degradation::none;
+  element->level_frames = 0;
+
+  return true;
+}
+
+//! @brief Unmaps the held input frames of the frames filtered out of place.
+void release(GstKalman *element) {
+  for (auto &input : element->inputs) {
+    if (input.buffer != nullptr) {
+      gst_video_frame_unmap(&input);
+    }
+  }
+  element->inputs.clear();
+}
+
+//! @brief Releases the buffers dropped from the queue of the output thread.
+void drop(const std::deque<queued_buffer> &buffers) {
+  for (const auto &[input, output] : buffers) {
+    gst_buffer_unref(input);
+    if (output != nullptr) {
+      gst_buffer_unref(output);
+    }
+  }
+}
+
+//! @brief Releases the held and pending frames of a batch.
+void discard(GstKalman *element) {
+  for (auto &frame : element->frames) {
+    gst_video_frame_unmap(&frame);
+  }
+  element->frames.clear();
+  release(element);
+  for (auto *buffer : element->outputs) {
+    gst_buffer_unref(buffer);
+  }
+  element->outputs.clear();
+}
+
+//! @brief Returns the path of the snapshot file of the negotiated video
+//! information.
+auto state_path(const GstKalman *element) -> std::string {
+  const auto *information{&element->info};
+  return element->state_file + "." +
+         gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(information)) + "." +
+         std::to_string(GST_VIDEO_INFO_WIDTH(information)) + "x" +
+         std::to_string(GST_VIDEO_INFO_HEIGHT(information));
+}
+
+//! @brief Queues a snapshot of the initialized filters for the background
+//! writer.
+//!
+//! @details Without waiting, the snapshot is retried on the next frame while
+//! the previous snapshot is still being written, for the streaming thread to
+//! never wait for the file.
+void snapshot(GstKalman *element, bool wait) {
+  if (!element->writer || element->reset) {
+    return;
+  }
+
+  const auto planes{GST_VIDEO_INFO_N_PLANES(&element->info)};
+  if (element->writer->write(
+          std::span{element->filters}.first(planes),
+          static_cast<std::uint32_t>(GST_VIDEO_INFO_FORMAT(&element->info)),
+          state_path(element), wait)) {
+    GST_DEBUG_OBJECT(element, "Queued a snapshot of the filters.");
+    element->snapshot_frames = 0;
+  }
+}
+
+//! @brief Restores the filters from the snapshot file of the negotiated
+//! video information, if any.
+//!
+//! @details The file is mapped and read in place. Returns whether the filters
+//! were restored, otherwise they are initialized from the next frame.
+auto restore(GstKalman *element) -> bool {
+  if (element->state_file.empty()) {
+    return false;
+  }
+
+  const auto path{state_path(element)};
+  const fcarouge::mapped_file file{path};
+  const auto planes{GST_VIDEO_INFO_N_PLANES(&element->info)};
+  const auto restored{fcarouge::restore(
+      file.bytes(),
+      static_cast<std::uint32_t>(GST_VIDEO_INFO_FORMAT(&element->info)),
+      std::span{element->filters}.first(planes),
+      {element->p, element->r, element->shared_covariance, element->precision,
+       element->q},
+      (1U << GST_VIDEO_INFO_COMP_DEPTH(&element->info, 0)) - 1U,
+      *element->pool)};
+  if (restored) {
+    GST_INFO_OBJECT(element, "Restored the filters from \"%s\".",
+                    path.c_str());
+  } else if (!file.bytes().empty()) {
+    GST_WARNING_OBJECT(element, "Ignored the mismatched snapshot \"%s\".",
+                       path.c_str());
+  }
+
+  return restored;
+}
+
+//! @brief Stops the workers on the element stop.
+//!
+//! @details The output thread is stopped, its queued frames and the held
+//! frames discarded. A snapshot of the filters is written. The filters are
+//! reallocated on the next negotiation.
+auto gst_kalman_stop(GstBaseTransform *element_base) -> gboolean {
+  auto *element{GST_KALMAN(element_base)};
+  if (element->stage) {
+    drop(element->stage->set_flushing(true));
+    element->stage.reset();
+  }
+  discard(element);
+  snapshot(element, true);
+  if (element->writer) {
+    element->writer->flush();
+    if (const auto failures{element->writer->failures()}; failures != 0) {
+      GST_ELEMENT_WARNING(element, RESOURCE, WRITE,
+                          ("Failed to write %zu snapshots of the filters.",
+                           failures),
+                          (nullptr));
+    }
+    element->writer.reset();
+  }
+  element->pool.reset();
+  gst_video_info_init(&element->info);
+
+  return true;
+}
+
+//! @brief Returns the number of columns and rows of macroblocks of the
+//! frames.
+auto macroblocks(const GstVideoInfo *information)
+    -> std::pair<std::size_t, std::size_t> {
+  constexpr auto size{fcarouge::pixel_kalman::macroblock_pixels};
+  return {(static_cast<std::size_t>(GST_VIDEO_INFO_WIDTH(information)) +
+           size - 1) /
+              size,
+          (static_cast<std::size_t>(GST_VIDEO_INFO_HEIGHT(information)) +
+           size - 1) /
+              size};
+}
+
+//! @brief Keeps the changes of the macroblocks of a filtered frame.
+//!
+//! @details The change flags of the macroblocks of the rows of the first
+//! plane are merged by rows of macroblocks.
+void keep(GstKalman *element, std::size_t frame,
+          std::span<const std::uint8_t> flags) {
+  const auto [columns, rows]{macroblocks(&element->info)};
+  auto *const changes{element->changes.data() + frame * columns * rows};
+  for (std::size_t row{0}; row < flags.size() / columns; ++row) {
+    auto *const merged{
+        changes + row / fcarouge::pixel_kalman::macroblock_pixels * columns};
+    const auto *const changed{flags.data() + row * columns};
+    for (std::size_t column{0}; column < columns; ++column) {
+      merged[column] |= changed[column];
+    }
+  }
+}
+
+//! @brief Removes the change map and change regions of interest of a previous
+//! filtering from the buffer, for those attached anew.
+//!
+//! @details An upstream element in series, filtering in place or copied out
+//! of place, would otherwise leave its stale changes first on the buffer.
+void detach(GstKalman *element, GstBuffer *buffer) {
+  static_cast<void>(gst_buffer_foreach_meta(
+      buffer,
+      [](GstBuffer *meta_buffer, GstMeta **meta, gpointer data) -> gboolean {
+        static_cast<void>(meta_buffer);
+        const auto *attaching{static_cast<const GstKalman *>(data)};
+        const auto api{(*meta)->info->api};
+        if ((attaching->change_meta &&
+             api == gst_kalman_change_meta_api_get_type()) ||
+            (attaching->roi_meta &&
+             api == GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE &&
+             reinterpret_cast<GstVideoRegionOfInterestMeta *>(*meta)
+                     ->roi_type ==
+                 g_quark_from_static_string(change_roi.data()))) {
+          *meta = nullptr;
+        }
+        return true;
+      },
+      element));
+}
+
+//! @brief Attaches the kept changes of a filtered frame to its buffer.
+//!
+//! @details The change map packs the changes of the macroblocks. The runs of
+//! changed macroblocks of each row are regions of interest, extended over the
+//! following rows with the same run. The changes of a previous filtering are
+//! replaced.
+void annotate(GstKalman *element, GstBuffer *buffer, std::size_t frame) {
+  const auto [columns, rows]{macroblocks(&element->info)};
+  if (element->changes.size() < (frame + 1) * columns * rows) {
+    return;
+  }
+
+  detach(element, buffer);
+
+  constexpr auto size{fcarouge::pixel_kalman::macroblock_pixels};
+  const auto *const changes{element->changes.data() + frame * columns * rows};
+  if (element->change_meta) {
+    auto *meta{add_change_meta(buffer, size, static_cast<guint>(columns),
+                               static_cast<guint>(rows))};
+    for (std::size_t row{0}; row < rows; ++row) {
+      for (std::size_t column{0}; column < columns; ++column) {
+        meta->map[row * meta->stride + column / 8] |= static_cast<guint8>(
+            (changes[row * columns + column] != 0) << (column % 8));
+      }
+    }
+  }
+
+  if (element->roi_meta) {
+    struct rectangle {
+      std::size_t left;
+      std::size_t right;
+      std::size_t top;
+      std::size_t bottom;
+    };
+    std::vector<rectangle> rectangles;
+    std::vector<std::size_t> previous;
+    std::vector<std::size_t> current;
+    for (std::size_t row{0}; row < rows; ++row) {
+      const auto *const changed{changes + row * columns};
+      auto above{previous.begin()};
+      for (std::size_t left{0}; left < columns; ++left) {
+        if (changed[left] == 0) {
+          continue;
+        }
+        auto right{left + 1};
+        while (right < columns && changed[right] != 0) {
+          ++right;
+        }
+        while (above != previous.end() && rectangles[*above].left < left) {
+          ++above;
+        }
+        if (above != previous.end() && rectangles[*above].left == left &&
+            rectangles[*above].right == right) {
+          rectangles[*above].bottom = row + 1;
+          current.push_back(*above);
+        } else {
+          current.push_back(rectangles.size());
+          rectangles.push_back({left, right, row, row + 1});
+        }
+        left = right;
+      }
+      std::swap(previous, current);
+      current.clear();
+    }
+
+    const auto width{
+        static_cast<std::size_t>(GST_VIDEO_INFO_WIDTH(&element->info))};
+    const auto height{
+        static_cast<std::size_t>(GST_VIDEO_INFO_HEIGHT(&element->info))};
+    for (const auto &region : rectangles) {
+      const auto x{region.left * size};
+      const auto y{region.top * size};
+      gst_buffer_add_video_region_of_interest_meta(
+          buffer, change_roi.data(), static_cast<guint>(x),
+          static_cast<guint>(y),
+          static_cast<guint>(std::min(region.right * size, width) - x),
+          static_cast<guint>(std::min(region.bottom * size, height) - y));
+    }
+  }
+}
+
+//! @brief Returns the stream time elapsed since the last filtered frame, in
+//! seconds, and records the timestamp of the frame.
+//!
+//! @details The presentation timestamps are preferred. The nominal frame
+//! duration stands for missing or backward timestamps, none for a variable
+//! framerate.
+auto elapsed(GstKalman *element, const GstVideoFrame &frame) -> float {
+  const auto timestamp{GST_BUFFER_PTS(frame.buffer)};
+  const auto previous{element->timestamp};
+  element->timestamp = timestamp;
+  if (GST_CLOCK_TIME_IS_VALID(timestamp) &&
+      GST_CLOCK_TIME_IS_VALID(previous) && timestamp > previous) {
+    return static_cast<float>(timestamp - previous) /
+           static_cast<float>(GST_SECOND);
+  }
+  const auto numerator{GST_VIDEO_INFO_FPS_N(&element->info)};
+  if (numerator <= 0) {
+    return 0.F;
+  }
+  return static_cast<float>(GST_VIDEO_INFO_FPS_D(&element->info)) /
+         static_cast<float>(numerator);
+}
+
+//! @brief Filters the planes of consecutive frames of samples of the pixel
+//! type.
+//!
+//! @details The filters are initialized from the first frame after a
+//! negotiation and updated by the subsequent frames, predicted over the
+//! stream time elapsed since their last update. The frames are filtered
+//! together, tile by tile. While decimating or skipping frames, the frames
+//! are filtered one by one and the frames without update pass the estimates
+//! through. The frames with a mapped input frame are filtered out of place.
+template <typename Pixel>
+void filter(GstKalman *element, std::span<GstVideoFrame> frames,
+            std::span<GstVideoFrame> inputs) {
+  const auto planes{GST_VIDEO_INFO_N_PLANES(&element->info)};
+  auto &first_filter{element->filters.front()};
+  first_filter.mapping = element->roi_meta || element->change_meta;
+  std::size_t kept{0};
+  if (first_filter.mapping) {
+    const auto [columns, rows]{macroblocks(&element->info)};
+    element->changes.assign(frames.size() * columns * rows, 0);
+  }
+  const auto view{[&frames, &inputs](std::size_t frame, guint index) {
+    auto *const input{frame < inputs.size() && inputs[frame].buffer != nullptr
+                          ? &inputs[frame]
+                          : nullptr};
+    return fcarouge::view<Pixel>(&frames[frame], index, input);
+  }};
+
+  if (element->reset) {
+    const fcarouge::pixel_kalman::configuration parameters{
+        element->p, element->r, element->shared_covariance,
+        element->precision, element->q};
+    for (guint index{0}; index < planes; ++index) {
+      element->filters[index].initialize(view(0, index), parameters,
+                                         *element->pool);
+    }
+    element->reset = false;
+    static_cast<void>(elapsed(element, frames.front()));
+    element->elapsed = 0.F;
+    element->decimated = 0;
+    if (first_filter.mapping) {
+      keep(element, kept++, first_filter.changed(0));
+    }
+    frames = frames.subspan(1);
+    inputs = inputs.subspan(std::min<std::size_t>(inputs.size(), 1));
+  }
+
+  const auto level{element->level};
+  for (guint index{0}; index < planes; ++index) {
+    element->filters[index].threshold = element->change_threshold;
+    if (level >= degradation::shared) {
+      element->filters[index].converge();
+    } else if (!element->shared_covariance) {
+      element->filters[index].diverge();
+    }
+  }
+  const auto detail{level >= degradation::half ? fcarouge::resolution::half
+                                               : fcarouge::resolution::full};
+
+  if (level == degradation::skip || element->decimation > 1) {
+    for (std::size_t frame{0}; frame < frames.size(); ++frame) {
+      element->elapsed += elapsed(element, frames[frame]);
+      element->skip = level == degradation::skip && !element->skip;
+      const auto due{++element->decimated >= element->decimation};
+      for (guint index{0}; index < planes; ++index) {
+        if (element->skip || !due) {
+          element->filters[index].estimate(view(frame, index), *element->pool);
+        } else {
+          element->filters[index].update(view(frame, index), *element->pool,
+                                         detail, element->elapsed);
+        }
+      }
+      if (!element->skip && due) {
+        element->elapsed = 0.F;
+        element->decimated = 0;
+      }
+      if (first_filter.mapping) {
+        keep(element, kept++, first_filter.changed(0));
+      }
+    }
+    return;
+  }
+
+  std::array<float, maximum_batch> times;
+  for (std::size_t frame{0}; frame < frames.size(); ++frame) {
+    times[frame] = element->elapsed + elapsed(element, frames[frame]);
+    element->elapsed = 0.F;
+  }
+  element->decimated = 0;
+  std::array<fcarouge::plane<Pixel>, maximum_batch> views;
+  for (guint index{0}; index < planes; ++index) {
+    for (std::size_t frame{0}; frame < frames.size(); ++frame) {
+      views[frame] = view(frame, index);
+    }
+    element->filters[index].update(
+        std::span<const fcarouge::plane<Pixel>>{views.data(), frames.size()},
+        *element->pool, detail,
+        std::span<const float>{times.data(), frames.size()});
+  }
+  if (first_filter.mapping) {
+    for (std::size_t frame{0}; frame < frames.size(); ++frame) {
+      keep(element, kept + frame, first_filter.changed(frame));
+    }
+  }
+}
+
+//! @brief Adapts the degradation level to the downstream quality of service.
+//!
+//! @details Degrades by one level while late, at most every few frames, up to
+//! the maximum level. Recovers by one level once downstream keeps up with some
+//! margin for long enough. Every frame is fully filtered without quality of
+//! service.
+void adapt(GstKalman *element, std::size_t frames) {
+  GST_OBJECT_LOCK(element);
+  const auto proportion{element->proportion};
+  const auto jitter{element->jitter};
+  GST_OBJECT_UNLOCK(element);
+
+  element->level_frames += static_cast<guint>(frames);
+  const auto maximum{
+      gst_base_transform_is_qos_enabled(GST_BASE_TRANSFORM(element))
+          ? element->maximum_degradation
+          : degradation::none};
+  auto level{element->level};
+  if (level > maximum) {
+    level = maximum;
+  } else if ((jitter > 0 || proportion > 1.) && level < maximum &&
+             element->level_frames >= settle_frames) {
+    level = static_cast<degradation>(static_cast<gint>(level) + 1);
+  } else if (jitter <= 0 && proportion < recover_proportion &&
+             level > degradation::none &&
+             element->level_frames >= recover_frames) {
+    level = static_cast<degradation>(static_cast<gint>(level) - 1);
+  }
+  if (level == element->level) {
+    return;
+  }
+
+  GST_INFO_OBJECT(element,
+                  "Degradation level %d, proportion %f, jitter "
+                  "%" G_GINT64_FORMAT ".",
+                  static_cast<gint>(level), proportion, jitter);
+  element->level = level;
+  element->level_frames = 0;
+  GST_OBJECT_LOCK(element);
+  element->statistics.degradation = static_cast<int>(level);
+  GST_OBJECT_UNLOCK(element);
+}
+
+//! @brief Filters consecutive frames with eight bits or sixteen bits wide
+//! samples.
+//!
+//! @details The degradation level is adapted first. The filters to initialize
+//! are restored from their snapshot, if any. The filtering and the workers are
+//! timed while timing the frames. The initializations of the filters are
+//! counted. A snapshot is taken every interval of frames.
+void filter(GstKalman *element, std::span<GstVideoFrame> frames,
+            std::span<GstVideoFrame> inputs = {}) {
+  adapt(element, frames.size());
+  if (element->reset && restore(element)) {
+    element->reset = false;
+  }
+  const auto initializing{element->reset};
+  const auto start{element->timing ? gst_util_get_timestamp() : 0};
+  element->pool->measure(element->timing);
+
+  if (fcarouge::sample_size(&element->info) == sizeof(guint16)) {
+    filter<guint16>(element, frames, inputs);
+  } else {
+    filter<guint8>(element, frames, inputs);
+  }
+
+  if (element->timing) {
+    element->kernel_time = gst_util_get_timestamp() - start;
+    double updated{0.};
+    std::size_t samples{0};
+    for (const auto &plane_filter : element->filters) {
+      updated += plane_filter.updated() *
+                 static_cast<double>(plane_filter.size());
+      samples += plane_filter.size();
+    }
+    element->updated =
+        samples != 0 ? updated / static_cast<double>(samples) : 1.;
+  }
+  if (initializing) {
+    GST_INFO_OBJECT(element, "Initialized the filters from the frame.");
+    GST_OBJECT_LOCK(element);
+    ++element->statistics.reinitializations;
+    GST_OBJECT_UNLOCK(element);
+  }
+  if (element->snapshot_interval != 0) {
+    element->snapshot_frames += static_cast<guint>(frames.size());
+    if (element->snapshot_frames >= element->snapshot_interval) {
+      snapshot(element, false);
+    }
+  }
+}
+
+//! @brief Returns a new structure of the statistics.
+auto structure(const fcarouge::statistics &statistics) -> GstStructure * {
+  return gst_structure_new(
+      "kalman-stats", "frames", G_TYPE_UINT64, statistics.frames,
+      "reinitializations", G_TYPE_UINT64, statistics.reinitializations,
+      "degradation", gst_kalman_degradation_get_type(),
+      statistics.degradation,
+      "kernel-p50", G_TYPE_UINT64, statistics.kernel.percentile(50),
+      "kernel-p90", G_TYPE_UINT64, statistics.kernel.percentile(90),
+      "kernel-p99", G_TYPE_UINT64, statistics.kernel.percentile(99),
+      "map-p50", G_TYPE_UINT64, statistics.map.percentile(50), "map-p90",
+      G_TYPE_UINT64, statistics.map.percentile(90), "map-p99", G_TYPE_UINT64,
+      statistics.map.percentile(99), "imbalance-p50", G_TYPE_DOUBLE,
+      statistics.imbalance.percentile(50), "imbalance-p90", G_TYPE_DOUBLE,
+      statistics.imbalance.percentile(90), "imbalance-p99", G_TYPE_DOUBLE,
+      statistics.imbalance.percentile(99), "updated-p50", G_TYPE_DOUBLE,
+      statistics.updated.percentile(50), "updated-p90", G_TYPE_DOUBLE,
+      statistics.updated.percentile(90), "updated-p99", G_TYPE_DOUBLE,
+      statistics.updated.percentile(99), nullptr);
+}
+
+//! @brief Records the timings of the filtered frames.
+//!
+//! @details The kernel and map times of the frames are shared equally by the
+//! frames. Logs and traces the timings, and posts the statistics on the bus
+//! every interval of frames.
+void record(GstKalman *element, GstClockTime kernel, GstClockTime map,
+            guint count) {
+  const auto imbalance{element->pool->imbalance()};
+  GST_CAT_LOG_OBJECT(gst_kalman_kernel_debug, element,
+                     "Filtered %u frames in %" GST_TIME_FORMAT
+                     ", worker imbalance %.3f.",
+                     count, GST_TIME_ARGS(kernel), imbalance);
+  GST_CAT_LOG_OBJECT(gst_kalman_map_debug, element,
+                     "Mapped %u frames in %" GST_TIME_FORMAT ".", count,
+                     GST_TIME_ARGS(map));
+  gst_tracer_record_log(frame_record, GST_OBJECT_NAME(element), count, kernel,
+                        map, imbalance);
+
+  GstStructure *message{nullptr};
+  GST_OBJECT_LOCK(element);
+  auto &statistics{element->statistics};
+  for (guint frame{0}; frame < count; ++frame) {
+    statistics.kernel.push(kernel / count);
+    statistics.map.push(map / count);
+    statistics.imbalance.push(imbalance);
+    statistics.updated.push(element->updated);
+    ++statistics.frames;
+    if (element->stats_interval != 0 &&
+        statistics.frames % element->stats_interval == 0) {
+      message = structure(statistics);
+    }
+  }
+  GST_OBJECT_UNLOCK(element);
+
+  if (message != nullptr) {
+    gst_element_post_message(
+        GST_ELEMENT(element),
+        gst_message_new_element(GST_OBJECT(element), message));
+  }
+}
+
+//! @brief Returns the latency added by holding the number of frames.
+//!
+//! @details The latency of a variable or unknown frame rate is unknown and
+//! not accounted for.
+auto frames_latency(const GstKalman *element, guint frames) -> GstClockTime {
+  const auto &information{element->info};
+  if (frames == 0 || GST_VIDEO_INFO_FPS_N(&information) <= 0) {
+    return 0;
+  }
+
+  return gst_util_uint64_scale_int(static_cast<guint64>(frames) * GST_SECOND,
+                                   GST_VIDEO_INFO_FPS_D(&information),
+                                   GST_VIDEO_INFO_FPS_N(&information));
+}
+
+//! @brief Filters the held frames and queues their buffers for output.
+void filter_batch(GstKalman *element) {
+  if (element->frames.empty()) {
+    return;
+  }
+
+  element->timing = element->collect_stats;
+  filter(element, element->frames, element->inputs);
+  const auto start{element->timing ? gst_util_get_timestamp() : 0};
+  release(element);
+  for (std::size_t index{0}; auto &frame : element->frames) {
+    auto *buffer{gst_buffer_ref(frame.buffer)};
+    gst_video_frame_unmap(&frame);
+    annotate(element, buffer, index++);
+    element->outputs.push_back(buffer);
+  }
+  if (element->timing) {
+    record(element, element->kernel_time,
+           element->map_time + gst_util_get_timestamp() - start,
+           static_cast<guint>(element->frames.size()));
+  }
+  element->map_time = 0;
+  element->frames.clear();
+}
+
+//! @brief Filters and pushes the held frames of an incomplete batch.
+auto drain(GstKalman *element) -> GstFlowReturn {
+  filter_batch(element);
+  auto status{GST_FLOW_OK};
+  while (!element->outputs.empty()) {
+    auto *buffer{element->outputs.front()};
+    element->outputs.pop_front();
+    if (status == GST_FLOW_OK) {
+      status = gst_pad_push(GST_BASE_TRANSFORM_SRC_PAD(element), buffer);
+    } else {
+      gst_buffer_unref(buffer);
+    }
+  }
+
+  return status;
+}
+
+//! @brief Allocates the filters on negotiation of new video information.
+//!
+//! @details The filters of each plane are allocated at the native resolution
+//! of the plane and initialized from the next frame. A renegotiation of the
+//! same information keeps the filters. Any other change, including a change
+//! of orientation or format at the same number of pixels, reallocates them,
+//! after a snapshot of the filters of the previous information.
+auto gst_kalman_set_info(GstVideoFilter *element_base,
+                         GstCaps *input_capabilities,
+                         GstVideoInfo *input_information,
+                         GstCaps *output_capabilities,
+                         GstVideoInfo *output_information) -> gboolean {
+  static_cast<void>(input_capabilities);
+  static_cast<void>(output_capabilities);
+  static_cast<void>(output_information);
 
-  if (GST_CLOCK_TIME_IS_VALID(GST_BUFFER_TIMESTAMP(output))) {
+  auto *element{GST_KALMAN(element_base)};
+  if (gst_video_info_is_equal(&element->info, input_information)) {
+    return true;
+  }
+
+  snapshot(element, true);
+  fcarouge::resize(element->filters, input_information, element->tile_size,
+                   element->granularity);
+  element->info = *input_information;
+  element->reset = true;
+  element->timestamp = GST_CLOCK_TIME_NONE;
+
+  if (element->batch > 1 || element->async_depth != 0) {
+    gst_element_post_message(GST_ELEMENT(element),
+                             gst_message_new_latency(GST_OBJECT(element)));
+  }
+
+  return true;
+}
+
+//! @brief Processes the video frame out of place.
+//!
+//! @details Filters the samples of each plane of the input frame into the
+//! output frame, tile by tile, the input samples read once.
+auto gst_kalman_transform_frame(GstVideoFilter *element_base,
+                                GstVideoFrame *input, GstVideoFrame *output)
+    -> GstFlowReturn {
+  if (GST_CLOCK_TIME_IS_VALID(GST_BUFFER_TIMESTAMP(input->buffer))) {
     gst_object_sync_values(GST_OBJECT(element_base),
-                           GST_BUFFER_TIMESTAMP(output));
+                           GST_BUFFER_TIMESTAMP(input->buffer));
   }
 
-  const sr::unique_resource source_capabilities{
-      gst_pad_get_current_caps(element_base->srcpad), gst_caps_unref};
-  g_return_val_if_fail(source_capabilities.get(), GST_FLOW_ERROR);
+  filter(GST_KALMAN(element_base), std::span{output, 1}, std::span{input, 1});
 
-  const auto *source_data{gst_caps_get_structure(source_capabilities.get(), 0)};
-  g_return_val_if_fail(source_data, GST_FLOW_ERROR);
+  return GST_FLOW_OK;
+}
 
-  gint width{0};
-  g_return_val_if_fail(gst_structure_get_int(source_data, "width", &width),
-                       GST_FLOW_ERROR);
+//! @brief Processes the video frame in-place.
+//!
+//! @details Filters the samples of each plane of the frame with eight bits or
+//! sixteen bits wide samples.
+auto gst_kalman_transform_frame_in_place(GstVideoFilter *element_base,
+                                         GstVideoFrame *frame)
+    -> GstFlowReturn {
+  if (GST_CLOCK_TIME_IS_VALID(GST_BUFFER_TIMESTAMP(frame->buffer))) {
+    gst_object_sync_values(GST_OBJECT(element_base),
+                           GST_BUFFER_TIMESTAMP(frame->buffer));
+  }
+
+  filter(GST_KALMAN(element_base), std::span{frame, 1});
+
+  return GST_FLOW_OK;
+}
+
+//! @brief Pushes the held frames before serialized events.
+//!
+//! @details The queued frames are filtered and pushed by the output thread,
+//! then the held frames are filtered and pushed, before any serialized event,
+//! including end-of-stream, segment, and capabilities, for the buffers to stay
+//! in order with the events. The queued frames are dropped on flush start,
+//! unblocking the streaming thread. The held frames, the flow return of the
+//! output thread, and the quality of service are discarded on flush stop.
+auto gst_kalman_sink_event(GstBaseTransform *element_base, GstEvent *event)
+    -> gboolean {
+  auto *element{GST_KALMAN(element_base)};
+  if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_START) {
+    if (element->stage) {
+      drop(element->stage->set_flushing(true));
+    }
+  } else if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+    if (element->stage) {
+      element->stage->flush();
+      static_cast<void>(element->stage->set_flushing(false));
+    }
+    discard(element);
+    element->status = GST_FLOW_OK;
+    GST_OBJECT_LOCK(element);
+    element->proportion = 1.;
+    element->jitter = 0;
+    GST_OBJECT_UNLOCK(element);
+  } else if (GST_EVENT_IS_SERIALIZED(event)) {
+    if (element->stage) {
+      element->stage->flush();
+    }
+    static_cast<void>(drain(element));
+  }
+
+  return GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+      ->sink_event(element_base, event);
+}
+
+//! @brief Keeps the downstream quality of service for the degradation level.
+//!
+//! @details The base transform also drops the frames already too late.
+auto gst_kalman_src_event(GstBaseTransform *element_base, GstEvent *event)
+    -> gboolean {
+  if (GST_EVENT_TYPE(event) == GST_EVENT_QOS) {
+    auto *element{GST_KALMAN(element_base)};
+    GstQOSType type{GST_QOS_TYPE_OVERFLOW};
+    gdouble proportion{1.};
+    GstClockTimeDiff jitter{0};
+    GstClockTime timestamp{GST_CLOCK_TIME_NONE};
+    gst_event_parse_qos(event, &type, &proportion, &jitter, &timestamp);
+    GST_OBJECT_LOCK(element);
+    element->proportion = proportion;
+    element->jitter = jitter;
+    GST_OBJECT_UNLOCK(element);
+  }
+
+  return GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+      ->src_event(element_base, event);
+}
+
+//! @brief Adds the latency of the batch and of the queue of the output thread
+//! to the upstream latency.
+//!
+//! @details The held frames of a batch delay every frame. The queued frames
+//! only delay the frames behind them while the filtering falls behind, the
+//! depth of the queue added to the maximum latency only, as a queue does.
+auto gst_kalman_query(GstBaseTransform *element_base, GstPadDirection direction,
+                      GstQuery *query) -> gboolean {
+  if (!GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+           ->query(element_base, direction, query)) {
+    return false;
+  }
+
+  if (direction == GST_PAD_SRC &&
+      GST_QUERY_TYPE(query) == GST_QUERY_LATENCY) {
+    const auto *element{GST_KALMAN(element_base)};
+    const auto latency{frames_latency(element, element->batch - 1)};
+    const auto queued{frames_latency(element, element->async_depth)};
+    if (latency != 0 || queued != 0) {
+      gboolean live{false};
+      GstClockTime minimum{0};
+      GstClockTime maximum{GST_CLOCK_TIME_NONE};
+      gst_query_parse_latency(query, &live, &minimum, &maximum);
+      minimum += latency;
+      if (GST_CLOCK_TIME_IS_VALID(maximum)) {
+        maximum += latency + queued;
+      }
+      gst_query_set_latency(query, live, minimum, maximum);
+    }
+  }
+
+  return true;
+}
+
+//! @brief Returns the number of buffers held on top of the buffer being
+//! processed.
+//!
+//! @details The frames of an incomplete batch are held, and in the
+//! asynchronous mode, the queued frames and the frame being filtered by the
+//! output thread.
+auto held(const GstKalman *element) -> guint {
+  return element->batch - 1 +
+         (element->async_depth != 0 ? element->async_depth + 1 : 0);
+}
 
-  gint height{0};
-  g_return_val_if_fail(gst_structure_get_int(source_data, "height", &height),
-                       GST_FLOW_ERROR);
+//! @brief Requests the strides of the rows of the frames of the pool aligned
+//! for the filters, if the pool supports it.
+//!
+//! @details The video buffer pools only pad the rows of their frames along
+//! with the video metadata describing the strides.
+void align(GstBufferPool *pool, GstStructure *configuration) {
+  if (!gst_buffer_pool_has_option(pool,
+                                  GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)) {
+    return;
+  }
+
+  GstVideoAlignment alignment;
+  gst_video_alignment_reset(&alignment);
+  for (auto &stride : alignment.stride_align) {
+    stride = stride_alignment - 1;
+  }
+  gst_buffer_pool_config_add_option(configuration,
+                                    GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+  gst_buffer_pool_config_set_video_alignment(configuration, &alignment);
+}
 
+//! @brief Proposes upstream buffer pools large enough for the held frames.
+//!
+//! @details The proposed pools align the strides of their frames.
+auto gst_kalman_propose_allocation(GstBaseTransform *element_base,
+                                   GstQuery *decide_query, GstQuery *query)
+    -> gboolean {
+  if (!GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+           ->propose_allocation(element_base, decide_query, query)) {
+    return false;
+  }
+
+  const auto holding{held(GST_KALMAN(element_base))};
+  for (guint index{0}; index < gst_query_get_n_allocation_pools(query);
+       ++index) {
+    GstBufferPool *pool{nullptr};
+    guint size{0};
+    guint minimum{0};
+    guint maximum{0};
+    gst_query_parse_nth_allocation_pool(query, index, &pool, &size, &minimum,
+                                        &maximum);
+    gst_query_set_nth_allocation_pool(query, index, pool, size,
+                                      minimum + holding,
+                                      maximum != 0 ? maximum + holding : 0);
+    if (pool != nullptr) {
+      auto *configuration{gst_buffer_pool_get_config(pool)};
+      align(pool, configuration);
+      static_cast<void>(gst_buffer_pool_set_config(pool, configuration));
+      gst_object_unref(pool);
+    }
+  }
+
+  return true;
+}
+
+//! @brief Decides the pool of the output buffers of the frames filtered out
+//! of place.
+//!
+//! @details The first downstream pool is kept, otherwise a video buffer pool
+//! is used. The pool holds the output buffers of the held frames on top of
+//! the downstream requirements. With the downstream support of the video
+//! metadata, the strides of the output frames are aligned for the filters.
+auto gst_kalman_decide_allocation(GstBaseTransform *element_base,
+                                  GstQuery *query) -> gboolean {
   auto *element{GST_KALMAN(element_base)};
-  auto &filters{element->filters};
-  const std::size_t resolution{static_cast<std::size_t>(width * height)};
-
-  GstMapInfo map;
-  const sr::unique_resource mapping{
-      gst_buffer_map(output, &map, GST_MAP_READWRITE),
-      [&map, &output](gboolean status) {
-        //! @todo Should the buffer be unmapped even on failed status?
-        static_cast<void>(status);
-        gst_buffer_unmap(output, &map);
-      }};
-
-  //! @todo Support additional formats, hardwares, contexts, and strategies.
-  const std::span pixels{map.data, resolution};
-
-  //! @todo Resolution is a poor indicator of the need to re-initialized the
-  //! filters.
-  //! @todo Should this check be performed as an event, signal, or capabilities
-  //! change instead of part of the transform?
-  if (resolution != filters.size()) {
-    //! @todo Support in-place non-default construction to avoid the secondary
-    //! initialization loop?
-    filters = std::vector<kalman>{resolution};
-    std::transform(std::execution::par_unseq, std::begin(pixels),
-                   std::end(pixels), std::begin(filters), std::begin(pixels),
-                   [element](const auto &pixel, auto &filter) {
-                     filter.x(static_cast<typename kalman::state>(pixel));
-                     filter.p(element->p);
-                     filter.r(element->r);
-                     return pixel;
-                   });
+  GstCaps *caps{nullptr};
+  gst_query_parse_allocation(query, &caps, nullptr);
+  GstBufferPool *pool{nullptr};
+  auto size{static_cast<guint>(GST_VIDEO_INFO_SIZE(&element->info))};
+  guint minimum{0};
+  guint maximum{0};
+  const auto pools{gst_query_get_n_allocation_pools(query)};
+  if (pools != 0) {
+    gst_query_parse_nth_allocation_pool(query, 0, &pool, &size, &minimum,
+                                        &maximum);
+  }
+  if (pool == nullptr) {
+    pool = gst_video_buffer_pool_new();
+  }
+
+  const auto holding{held(element)};
+  minimum += holding;
+  maximum = maximum != 0 ? maximum + holding : 0;
+  auto *configuration{gst_buffer_pool_get_config(pool)};
+  gst_buffer_pool_config_set_params(configuration, caps, size, minimum,
+                                    maximum);
+  if (gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE,
+                                     nullptr) &&
+      gst_buffer_pool_has_option(pool, GST_BUFFER_POOL_OPTION_VIDEO_META)) {
+    gst_buffer_pool_config_add_option(configuration,
+                                      GST_BUFFER_POOL_OPTION_VIDEO_META);
+    align(pool, configuration);
+  }
+  if (!gst_buffer_pool_set_config(pool, configuration)) {
+    configuration = gst_buffer_pool_get_config(pool);
+    if (!gst_buffer_pool_config_validate_params(configuration, caps, size,
+                                                minimum, maximum) ||
+        !gst_buffer_pool_set_config(pool, configuration)) {
+      GST_WARNING_OBJECT(element, "Rejected buffer pool configuration.");
+      gst_object_unref(pool);
+      return false;
+    }
+  }
+
+  if (pools != 0) {
+    gst_query_set_nth_allocation_pool(query, 0, pool, size, minimum,
+                                      maximum);
   } else {
-    //! @todo Use the timestamp of the frame if available?
-    std::transform(std::execution::par_unseq, std::begin(pixels),
-                   std::end(pixels), std::begin(filters), std::begin(pixels),
-                   []<typename Pixel>(const Pixel &pixel, auto &filter) {
-                     filter.update(static_cast<typename kalman::output>(pixel));
-                     using limit = std::numeric_limits<Pixel>;
-                     return std::clamp<Pixel>(filter.x(), limit::min(),
-                                              limit::max());
-                   });
+    gst_query_add_allocation_pool(query, pool, size, minimum, maximum);
+  }
+  gst_object_unref(pool);
+
+  return GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+      ->decide_allocation(element_base, query);
+}
+
+//! @brief Outputs the writable input buffers, filtered in place, or a pooled
+//! buffer otherwise.
+//!
+//! @details Copying the read-only input buffers before filtering them in
+//! place is avoided, for example after a tee or from a decoder pool.
+auto gst_kalman_prepare_output_buffer(GstBaseTransform *element_base,
+                                      GstBuffer *input, GstBuffer **output)
+    -> GstFlowReturn {
+  if (gst_buffer_is_writable(input)) {
+    *output = input;
+    return GST_FLOW_OK;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+      ->prepare_output_buffer(element_base, input, output);
+}
+
+//! @brief Prepares the output buffer of the input buffer filtered out of
+//! place, null for the writable input buffers filtered in place.
+//!
+//! @details The input buffer is released on failure.
+auto prepare(GstKalman *element, GstBuffer *input, GstBuffer **output)
+    -> GstFlowReturn {
+  *output = nullptr;
+  if (gst_buffer_is_writable(input)) {
+    return GST_FLOW_OK;
+  }
+
+  const auto status{GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+                        ->prepare_output_buffer(GST_BASE_TRANSFORM(element),
+                                                input, output)};
+  if (status != GST_FLOW_OK) {
+    gst_buffer_unref(input);
+    if (*output != nullptr) {
+      gst_buffer_unref(std::exchange(*output, nullptr));
+    }
+  }
+
+  return status;
+}
+
+//! @brief Maps and holds the frame of the buffers, and filters the held
+//! frames once the batch is complete.
+//!
+//! @details The buffers are taken over. The input frame is held along with
+//! the output frame, if any, and filtered out of place.
+auto hold(GstKalman *element, const queued_buffer &buffers) -> GstFlowReturn {
+  const auto start{element->collect_stats ? gst_util_get_timestamp() : 0};
+  auto *buffer{buffers.input};
+  GstVideoFrame source{};
+  if (buffers.output != nullptr) {
+    buffer = buffers.output;
+    const auto read{gst_video_frame_map(&source, &element->info,
+                                        buffers.input, GST_MAP_READ)};
+    gst_buffer_unref(buffers.input);
+    if (!read) {
+      gst_buffer_unref(buffer);
+      return GST_FLOW_ERROR;
+    }
+  }
+  GstVideoFrame frame;
+  const auto mapped{gst_video_frame_map(
+      &frame, &element->info, buffer,
+      source.buffer != nullptr ? GST_MAP_WRITE : GST_MAP_READWRITE)};
+  gst_buffer_unref(buffer);
+  if (!mapped && source.buffer != nullptr) {
+    gst_video_frame_unmap(&source);
+  }
+  g_return_val_if_fail(mapped, GST_FLOW_ERROR);
+  if (element->collect_stats) {
+    element->map_time += gst_util_get_timestamp() - start;
+  }
+
+  element->frames.push_back(frame);
+  element->inputs.push_back(source);
+  if (element->frames.size() >= element->batch) {
+    filter_batch(element);
   }
 
   return GST_FLOW_OK;
 }
 
+//! @brief Filters the queued buffers on the output thread and pushes the
+//! filtered buffers downstream.
+//!
+//! @details After a failure to filter or push, the next buffers are dropped
+//! until the flow return is reset on flush.
+void deliver(GstKalman *element, const queued_buffer &buffers) {
+  auto status{element->status.load()};
+  if (status != GST_FLOW_OK) {
+    drop({buffers});
+    return;
+  }
+
+  status = hold(element, buffers);
+  while (!element->outputs.empty()) {
+    auto *buffer{element->outputs.front()};
+    element->outputs.pop_front();
+    if (status == GST_FLOW_OK) {
+      status = gst_pad_push(GST_BASE_TRANSFORM_SRC_PAD(element), buffer);
+    } else {
+      gst_buffer_unref(buffer);
+    }
+  }
+  if (status != GST_FLOW_OK) {
+    GST_DEBUG_OBJECT(element, "Output thread flow return %s.",
+                     gst_flow_get_name(status));
+    element->status = status;
+  }
+}
+
+//! @brief Holds the input frames and outputs them by batches, or queues them
+//! for the output thread.
+//!
+//! @details Without batching nor output thread, the frames are filtered one
+//! at a time by the frame transforms. Otherwise, the input frame is mapped
+//! and held, the held frames filtered together once the batch is complete,
+//! and their buffers output one per call. The read-only input frames are held
+//! along with a pooled output frame, and filtered out of place. In the
+//! asynchronous mode, the buffers are queued for the output thread to hold,
+//! filter, and push, the streaming thread returning upstream at once unless
+//! the queue is full. The last flow return of the output thread is returned.
+auto gst_kalman_generate_output(GstBaseTransform *element_base,
+                                GstBuffer **output) -> GstFlowReturn {
+  auto *element{GST_KALMAN(element_base)};
+  if (!element->stage && element->batch <= 1 && element->frames.empty() &&
+      element->outputs.empty()) {
+    return GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+        ->generate_output(element_base, output);
+  }
+
+  if (auto *input{std::exchange(element_base->queued_buf, nullptr)}) {
+    if (GST_CLOCK_TIME_IS_VALID(GST_BUFFER_TIMESTAMP(input))) {
+      gst_object_sync_values(GST_OBJECT(element),
+                             GST_BUFFER_TIMESTAMP(input));
+    }
+
+    queued_buffer buffers{input};
+    if (const auto status{prepare(element, input, &buffers.output)};
+        status != GST_FLOW_OK) {
+      return status;
+    }
+    if (element->stage) {
+      if (!element->stage->push(buffers)) {
+        drop({buffers});
+        return GST_FLOW_FLUSHING;
+      }
+      return element->status;
+    }
+    if (const auto status{hold(element, buffers)}; status != GST_FLOW_OK) {
+      return status;
+    }
+  }
+
+  if (!element->outputs.empty()) {
+    *output = element->outputs.front();
+    element->outputs.pop_front();
+  }
+
+  return element->stage ? element->status.load() : GST_FLOW_OK;
+}
+
+//! @brief Times the processing of the output buffer by the video filter while
+//! collecting the statistics and attaches its changes.
+//!
+//! @details The video filter maps the frames, processes them, and unmaps
+//! them. The map time is the remainder of the filtering time. The metadata is
+//! attached once the frames are unmapped, the buffer writable again.
+template <typename Function>
+auto process(GstKalman *element, GstBuffer *buffer, Function function)
+    -> GstFlowReturn {
+  element->timing = element->collect_stats;
+  element->changes.clear();
+  if (!element->timing) {
+    const auto status{function()};
+    if (status == GST_FLOW_OK) {
+      annotate(element, buffer, 0);
+    }
+    return status;
+  }
+
+  element->kernel_time = 0;
+  const auto start{gst_util_get_timestamp()};
+  const auto status{function()};
+  const auto elapsed{gst_util_get_timestamp() - start};
+  if (status == GST_FLOW_OK) {
+    record(element, element->kernel_time,
+           elapsed - std::min(elapsed, element->kernel_time), 1);
+    annotate(element, buffer, 0);
+  }
+
+  return status;
+}
+
+//! @brief Processes the buffer in place, if output in place, otherwise out of
+//! place.
+auto gst_kalman_transform(GstBaseTransform *element_base, GstBuffer *input,
+                          GstBuffer *output) -> GstFlowReturn {
+  if (input == output) {
+    return gst_kalman_transform_in_place(element_base, output);
+  }
+
+  return process(GST_KALMAN(element_base), output, [=] {
+    return GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+        ->transform(element_base, input, output);
+  });
+}
+
+//! @brief Processes the buffer in place.
+auto gst_kalman_transform_in_place(GstBaseTransform *element_base,
+                                   GstBuffer *buffer) -> GstFlowReturn {
+  return process(GST_KALMAN(element_base), buffer, [=] {
+    return GST_BASE_TRANSFORM_CLASS(gst_kalman_parent_class)
+        ->transform_ip(element_base, buffer);
+  });
+}
+
 } // namespace
@@ -0,0 +1,97 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The declarations shared by the elements of the plugin.
+
+#ifndef FCAROUGE_GSTKALMAN_HPP
+#define FCAROUGE_GSTKALMAN_HPP
+
+#include "pixel_kalman.hpp"
+
+#include <glib-object.h>
+#include <gst/gst.h>
+
+#include <array>
+
+//! @brief Registers and provides the precision enumeration type.
+//!
+//! @details Registered once for all the elements of the plugin.
+inline auto gst_kalman_precision_get_type() -> GType {
+  static const GType type{[] {
+    static constexpr std::array values{
+        GEnumValue{static_cast<gint>(fcarouge::precision::single),
+                   "Single precision floating-point estimates", "float"},
+        GEnumValue{static_cast<gint>(fcarouge::precision::fixed),
+                   "Fixed-point estimates of samples up to 10 bits with the "
+                   "shared covariance",
+                   "fixed"},
+        GEnumValue{static_cast<gint>(fcarouge::precision::half),
+                   "Half precision floating-point storage of the estimates "
+                   "and uncertainties",
+                   "half"},
+        GEnumValue{static_cast<gint>(fcarouge::precision::bfloat),
+                   "Bfloat16 floating-point storage of the estimates and "
+                   "uncertainties",
+                   "bfloat16"},
+        GEnumValue{0, nullptr, nullptr}};
+    return g_enum_register_static("GstKalmanPrecision", values.data());
+  }()};
+  return type;
+}
+
+//! @brief Registers and provides the granularity enumeration type.
+//!
+//! @details The values are the number of pixels of the side of the square
+//! blocks of pixels sharing a filter.
+inline auto gst_kalman_granularity_get_type() -> GType {
+  static const GType type{[] {
+    static constexpr std::array values{
+        GEnumValue{1, "One filter per pixel", "1x1"},
+        GEnumValue{2, "One filter per block of two by two pixels", "2x2"},
+        GEnumValue{4, "One filter per block of four by four pixels", "4x4"},
+        GEnumValue{0, nullptr, nullptr}};
+    return g_enum_register_static("GstKalmanGranularity", values.data());
+  }()};
+  return type;
+}
+
+// Declares the registration of the multiple stream element.
+GST_ELEMENT_REGISTER_DECLARE(multikalman);
+
+#endif // FCAROUGE_GSTKALMAN_HPP
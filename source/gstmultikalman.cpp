@@ -0,0 +1,873 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The GStreamer multiple stream Kalman filter video element.
+//!
+//! @details Filters many streams in one element. Each request sink pad has
+//! its source pad. The frames of the streams arriving in a time slot are
+//! filtered together, their tiles scheduled on one shared worker pool.
+
+#include "gstkalman.hpp"
+#include "pixel_kalman.hpp"
+#include "video_frame.hpp"
+#include "worker_pool.hpp"
+
+#include <glib-object.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+// Declares the debug category of the element.
+GST_DEBUG_CATEGORY_STATIC(gst_multi_kalman_debug);
+#define GST_CAT_DEFAULT gst_multi_kalman_debug
+
+//! @brief A stream of the element, its pads and the filters of its planes.
+//!
+//! @details Guarded by the element mutex, but for the filters and frame of a
+//! stream scheduled in the running time slot, owned by the filtering thread.
+struct stream {
+  //! @brief The request sink pad of the stream.
+  GstPad *sink{nullptr};
+
+  //! @brief The source pad of the stream.
+  GstPad *source{nullptr};
+
+  //! @brief The negotiated video information of the stream.
+  GstVideoInfo info{};
+
+  //! @brief Whether the video information is negotiated.
+  bool negotiated{false};
+
+  //! @brief The Kalman filters of the samples of each plane of the frames.
+  std::array<fcarouge::pixel_kalman, GST_VIDEO_MAX_PLANES> filters;
+
+  //! @brief Whether the filters are initialized from the next frame.
+  bool reset{true};
+
+  //! @brief The mapped frame waiting for its time slot.
+  GstVideoFrame frame{};
+
+  //! @brief Whether a frame waits for its time slot.
+  bool pending{false};
+
+  //! @brief Whether the waiting frame is in the running time slot.
+  bool scheduled{false};
+
+  //! @brief Whether the waiting frame was filtered.
+  bool filtered{false};
+
+  //! @brief Whether the stream ended, no longer awaited by the time slots.
+  bool ended{false};
+
+  //! @brief Whether the stream is flushing, its waiting frame dropped.
+  bool flushing{false};
+};
+
+//! @brief The GStreamer multiple stream Kalman filter video element
+//! datastructure.
+//!
+//! @details A GObject, GLib, GStreamer compatible element datastructure. The
+//! name `_GstMultiKalman` conforms to the GObject framework naming
+//! expectations.
+struct _GstMultiKalman {
+  //! @brief The element base class.
+  GstElement element;
+
+  //! @brief The guard of the streams and of the time slots.
+  std::mutex mutex;
+
+  //! @brief The notification of the frames, filtered time slots, and stream
+  //! events.
+  std::condition_variable condition;
+
+  //! @brief The streams, of stable addresses for their pads.
+  std::list<stream> streams;
+
+  //! @brief The index of the next requested pads without a name.
+  guint next_index{0};
+
+  //! @brief Whether a time slot is being filtered.
+  bool busy{false};
+
+  //! @brief The workers filtering the tiles of all the streams, while
+  //! started.
+  std::unique_ptr<fcarouge::worker_pool> pool;
+
+  //! @brief The filter's initialization estimate uncertainty characteristics.
+  float p{1.F};
+
+  //! @brief The filter's initialization output uncertainty characteristics.
+  float r{0.F};
+
+  //! @brief Whether the filters share their estimate uncertainty and gain.
+  bool shared_covariance{true};
+
+  //! @brief The requested representation of the filters' estimates.
+  fcarouge::precision precision{fcarouge::precision::single};
+
+  //! @brief The number of workers, zero for one per hardware thread.
+  guint threads{0};
+
+  //! @brief The number of samples of a tile, rounded to whole rows.
+  guint tile_size{65536};
+
+  //! @brief The list of processors to pin the workers to, if any.
+  std::string processors;
+
+  //! @brief The longest wait of a frame for the frames of the other streams
+  //! of its time slot, in nanoseconds.
+  guint64 slot_duration{10 * GST_MSECOND};
+
+  //! @brief The number of pixels of the side of the square blocks of pixels
+  //! sharing a filter.
+  guint granularity{1};
+};
+
+//! @brief The GStreamer multiple stream Kalman filter element properties.
+//!
+//! @todo Understand why GLib must have a zero-th property.
+enum property : guint {
+  _,
+  p,
+  r,
+  shared_covariance,
+  precision,
+  threads,
+  tile_size,
+  processors,
+  slot_duration,
+  granularity
+};
+
+constexpr std::string_view name{"multikalman"};
+constexpr std::string_view classification{"Filter/Effect/Video"};
+constexpr std::string_view long_name{"Multiple Stream Kalman Filter"};
+constexpr std::string_view description{
+    "A video Kalman filter of many streams sharing its workers."};
+constexpr std::string_view author{
+    "Francois Carouge <francois.carouge@gmail.com>"};
+//! @todo Support the little endian formats on big endian hosts.
+constexpr std::string_view capabilities{
+    GST_VIDEO_CAPS_MAKE("{ GRAY8, GRAY16_LE, I420, NV12, RGBA, BGRA, "
+                        "I420_10LE, I422_10LE, Y444_10LE }")};
+
+// Declares the GstMultiKalman element, a final class, part of the GStreamer
+// module, derived from the element, and defines type support.
+G_DECLARE_FINAL_TYPE(GstMultiKalman, gst_multi_kalman, GST, MULTI_KALMAN,
+                     GstElement)
+G_DEFINE_TYPE(GstMultiKalman, gst_multi_kalman, GST_TYPE_ELEMENT);
+
+void gst_multi_kalman_set_property(GObject *object, guint prop_id,
+                                   const GValue *value, GParamSpec *pspec);
+void gst_multi_kalman_get_property(GObject *object, guint prop_id,
+                                   GValue *value, GParamSpec *pspec);
+void gst_multi_kalman_finalize(GObject *object);
+auto gst_multi_kalman_change_state(GstElement *element,
+                                   GstStateChange transition)
+    -> GstStateChangeReturn;
+auto gst_multi_kalman_request_new_pad(GstElement *element,
+                                      GstPadTemplate *pad_template,
+                                      const gchar *pad_name,
+                                      const GstCaps *requested) -> GstPad *;
+void gst_multi_kalman_release_pad(GstElement *element, GstPad *pad);
+auto gst_multi_kalman_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer)
+    -> GstFlowReturn;
+auto gst_multi_kalman_sink_event(GstPad *pad, GstObject *parent,
+                                 GstEvent *event) -> gboolean;
+auto gst_multi_kalman_source_query(GstPad *pad, GstObject *parent,
+                                   GstQuery *query) -> gboolean;
+auto gst_multi_kalman_iterate_internal_links(GstPad *pad, GstObject *parent)
+    -> GstIterator *;
+
+//! @brief Defines the element details.
+//!
+//! @details Sets up the element metadata, request sink and sometimes source
+//! pads, and properties.
+void gst_multi_kalman_class_init(GstMultiKalmanClass *klass) {
+  auto *object_klass{G_OBJECT_CLASS(klass)};
+  object_klass->set_property = gst_multi_kalman_set_property;
+  object_klass->get_property = gst_multi_kalman_get_property;
+  object_klass->finalize = gst_multi_kalman_finalize;
+
+  constexpr GParamFlags described_readwrite{
+      static_cast<GParamFlags>(static_cast<unsigned>(G_PARAM_READWRITE) |
+                               static_cast<unsigned>(G_PARAM_STATIC_STRINGS))};
+  constexpr auto max_float{std::numeric_limits<float>::max()};
+  g_object_class_install_property(
+      object_klass, property::p,
+      g_param_spec_float("p", "P", "Initialize estimate uncertainty.", 0.,
+                         max_float, 1., described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::r,
+      g_param_spec_float("r", "R", "Initialize output uncertainty.", 0.,
+                         max_float, 0., described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::shared_covariance,
+      g_param_spec_boolean(
+          "shared-covariance", "Shared Covariance",
+          "Advance one estimate uncertainty and gain per frame for all pixels.",
+          true, described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::precision,
+      g_param_spec_enum("precision", "Precision",
+                        "Representation of the estimates.",
+                        gst_kalman_precision_get_type(),
+                        static_cast<gint>(fcarouge::precision::single),
+                        described_readwrite));
+  constexpr GParamFlags described_readwrite_ready{static_cast<GParamFlags>(
+      static_cast<unsigned>(described_readwrite) |
+      static_cast<unsigned>(GST_PARAM_MUTABLE_READY))};
+  g_object_class_install_property(
+      object_klass, property::threads,
+      g_param_spec_uint("n-threads", "Threads",
+                        "Number of workers shared by the streams, 0 for one "
+                        "per hardware thread.",
+                        0, std::numeric_limits<guint>::max(), 0,
+                        described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::tile_size,
+      g_param_spec_uint("tile-size", "Tile Size",
+                        "Number of samples of a tile of work, in whole rows.",
+                        1, std::numeric_limits<guint>::max(), 65536,
+                        described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::processors,
+      g_param_spec_string("cpus", "CPUs",
+                          "Processors to pin the workers to, for example "
+                          "\"0,2-5\", empty for no pinning.",
+                          "", described_readwrite_ready));
+  g_object_class_install_property(
+      object_klass, property::slot_duration,
+      g_param_spec_uint64("slot-duration", "Slot Duration",
+                          "Longest wait of a frame for the frames of the "
+                          "other streams of its time slot, in nanoseconds.",
+                          0, std::numeric_limits<guint64>::max(),
+                          10 * GST_MSECOND, described_readwrite));
+  g_object_class_install_property(
+      object_klass, property::granularity,
+      g_param_spec_enum("granularity", "Granularity",
+                        "Square blocks of pixels sharing a filter, updated "
+                        "with the mean of their samples.",
+                        gst_kalman_granularity_get_type(), 1,
+                        described_readwrite_ready));
+
+  GST_DEBUG_CATEGORY_INIT(gst_multi_kalman_debug, "multikalman", 0,
+                          "Multiple stream Kalman filter element");
+
+  auto *gstelement_klass{GST_ELEMENT_CLASS(klass)};
+  gst_element_class_set_static_metadata(gstelement_klass, long_name.data(),
+                                        classification.data(),
+                                        description.data(), author.data());
+
+  GstStaticPadTemplate sink_template{"sink_%u", GstPadDirection::GST_PAD_SINK,
+                                     GstPadPresence::GST_PAD_REQUEST,
+                                     GST_STATIC_CAPS(capabilities.data())};
+  gst_element_class_add_pad_template(
+      gstelement_klass, gst_static_pad_template_get(&sink_template));
+
+  GstStaticPadTemplate source_template{"src_%u", GstPadDirection::GST_PAD_SRC,
+                                       GstPadPresence::GST_PAD_SOMETIMES,
+                                       GST_STATIC_CAPS(capabilities.data())};
+  gst_element_class_add_pad_template(
+      gstelement_klass, gst_static_pad_template_get(&source_template));
+
+  gstelement_klass->change_state =
+      GST_DEBUG_FUNCPTR(gst_multi_kalman_change_state);
+  gstelement_klass->request_new_pad =
+      GST_DEBUG_FUNCPTR(gst_multi_kalman_request_new_pad);
+  gstelement_klass->release_pad =
+      GST_DEBUG_FUNCPTR(gst_multi_kalman_release_pad);
+}
+
+//! @brief Sets the element properties.
+void gst_multi_kalman_set_property(GObject *object, guint prop_id,
+                                   const GValue *value, GParamSpec *pspec) {
+  auto *element{GST_MULTI_KALMAN(object)};
+
+  switch (prop_id) {
+  case property::p:
+    element->p = g_value_get_float(value);
+    break;
+  case property::r:
+    element->r = g_value_get_float(value);
+    break;
+  case property::shared_covariance:
+    element->shared_covariance = g_value_get_boolean(value) != 0;
+    break;
+  case property::precision:
+    element->precision =
+        static_cast<fcarouge::precision>(g_value_get_enum(value));
+    break;
+  case property::threads:
+    element->threads = g_value_get_uint(value);
+    break;
+  case property::tile_size:
+    element->tile_size = g_value_get_uint(value);
+    break;
+  case property::processors: {
+    const auto *list{g_value_get_string(value)};
+    element->processors = list != nullptr ? list : "";
+    break;
+  }
+  case property::slot_duration:
+    element->slot_duration = g_value_get_uint64(value);
+    break;
+  case property::granularity:
+    element->granularity = static_cast<guint>(g_value_get_enum(value));
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    break;
+  }
+}
+
+//! @brief Gets the element properties.
+void gst_multi_kalman_get_property(GObject *object, guint prop_id,
+                                   GValue *value, GParamSpec *pspec) {
+  auto *element{GST_MULTI_KALMAN(object)};
+
+  switch (prop_id) {
+  case property::p:
+    g_value_set_float(value, element->p);
+    break;
+  case property::r:
+    g_value_set_float(value, element->r);
+    break;
+  case property::shared_covariance:
+    g_value_set_boolean(value, element->shared_covariance);
+    break;
+  case property::precision:
+    g_value_set_enum(value, static_cast<gint>(element->precision));
+    break;
+  case property::threads:
+    g_value_set_uint(value, element->threads);
+    break;
+  case property::tile_size:
+    g_value_set_uint(value, element->tile_size);
+    break;
+  case property::processors:
+    g_value_set_string(value, element->processors.c_str());
+    break;
+  case property::slot_duration:
+    g_value_set_uint64(value, element->slot_duration);
+    break;
+  case property::granularity:
+    g_value_set_enum(value, static_cast<gint>(element->granularity));
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    break;
+  }
+}
+
+//! @brief Instantiates the element.
+//!
+//! @details The GObject instance storage is zero-initialized, not constructed.
+//! The C++ members are constructed in place for their default member
+//! initializers to apply.
+void gst_multi_kalman_init(GstMultiKalman *element) {
+  new (&element->mutex) std::mutex{};
+  new (&element->condition) std::condition_variable{};
+  new (&element->streams) std::list<stream>{};
+  new (&element->next_index) guint{0};
+  new (&element->busy) bool{false};
+  new (&element->pool) std::unique_ptr<fcarouge::worker_pool>{};
+  new (&element->p) float{1.F};
+  new (&element->r) float{0.F};
+  new (&element->shared_covariance) bool{true};
+  new (&element->precision) fcarouge::precision{fcarouge::precision::single};
+  new (&element->threads) guint{0};
+  new (&element->tile_size) guint{65536};
+  new (&element->processors) std::string{};
+  new (&element->slot_duration) guint64{10 * GST_MSECOND};
+  new (&element->granularity) guint{1};
+}
+
+//! @brief Destroys the element.
+//!
+//! @details Destroys the C++ members constructed in place on instantiation
+//! before chaining up to the parent class.
+void gst_multi_kalman_finalize(GObject *object) {
+  auto *element{GST_MULTI_KALMAN(object)};
+  std::destroy_at(&element->processors);
+  std::destroy_at(&element->pool);
+  std::destroy_at(&element->streams);
+  std::destroy_at(&element->condition);
+  std::destroy_at(&element->mutex);
+
+  G_OBJECT_CLASS(gst_multi_kalman_parent_class)->finalize(object);
+}
+
+//! @brief Starts the shared workers when paused and stops them when ready.
+//!
+//! @details The waiting frames are released before the deactivation of the
+//! pads. Fails on an invalid processors list.
+auto gst_multi_kalman_change_state(GstElement *element_base,
+                                   GstStateChange transition)
+    -> GstStateChangeReturn {
+  auto *element{GST_MULTI_KALMAN(element_base)};
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+    const auto processors{fcarouge::parse_processors(element->processors)};
+    if (!processors) {
+      GST_ELEMENT_ERROR(element, RESOURCE, SETTINGS,
+                        ("Invalid processors list \"%s\".",
+                         element->processors.c_str()),
+                        (nullptr));
+      return GST_STATE_CHANGE_FAILURE;
+    }
+    element->pool =
+        std::make_unique<fcarouge::worker_pool>(element->threads, *processors);
+    const std::scoped_lock lock{element->mutex};
+    for (auto &current : element->streams) {
+      current.flushing = false;
+      current.ended = false;
+      current.reset = true;
+    }
+  } else if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    const std::scoped_lock lock{element->mutex};
+    for (auto &current : element->streams) {
+      current.flushing = true;
+    }
+    element->condition.notify_all();
+  }
+
+  const auto result{GST_ELEMENT_CLASS(gst_multi_kalman_parent_class)
+                        ->change_state(element_base, transition)};
+
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    element->pool.reset();
+  }
+
+  return result;
+}
+
+//! @brief Returns the stream of a pad of the element.
+auto stream_of(GstPad *pad) -> stream & {
+  return *static_cast<stream *>(gst_pad_get_element_private(pad));
+}
+
+//! @brief Parses the index of the requested sink pad name. Returns whether the
+//! name is a sink pad name with an index.
+auto parse_index(std::string_view pad_name, guint &index) -> bool {
+  constexpr std::string_view prefix{"sink_"};
+  if (!pad_name.starts_with(prefix)) {
+    return false;
+  }
+  const auto *const last{pad_name.data() + pad_name.size()};
+  const auto [end, error]{
+      std::from_chars(pad_name.data() + prefix.size(), last, index)};
+  return error == std::errc{} && end == last;
+}
+
+//! @brief Adds a stream, its requested sink pad and its source pad.
+//!
+//! @details The source pad has the index of the sink pad. The capabilities
+//! and allocation queries are proxied between the pads of the stream.
+auto gst_multi_kalman_request_new_pad(GstElement *element_base,
+                                      GstPadTemplate *pad_template,
+                                      const gchar *pad_name,
+                                      const GstCaps *requested) -> GstPad * {
+  static_cast<void>(requested);
+
+  auto *element{GST_MULTI_KALMAN(element_base)};
+  std::unique_lock lock{element->mutex};
+  auto index{element->next_index};
+  if (pad_name != nullptr && !parse_index(pad_name, index)) {
+    GST_WARNING_OBJECT(element, "Invalid requested pad name \"%s\".",
+                       pad_name);
+    return nullptr;
+  }
+  const auto sink_name{"sink_" + std::to_string(index)};
+  if (std::ranges::any_of(element->streams, [&sink_name](const auto &current) {
+        return GST_PAD_NAME(current.sink) == sink_name;
+      })) {
+    GST_WARNING_OBJECT(element, "The pad \"%s\" already exists.",
+                       sink_name.c_str());
+    return nullptr;
+  }
+  element->next_index = std::max(element->next_index, index + 1);
+
+  auto &current{element->streams.emplace_back()};
+  current.sink = gst_pad_new_from_template(pad_template, sink_name.c_str());
+  current.source = gst_pad_new_from_template(
+      gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(element),
+                                         "src_%u"),
+      ("src_" + std::to_string(index)).c_str());
+  for (auto *pad : {current.sink, current.source}) {
+    gst_pad_set_element_private(pad, &current);
+    gst_pad_set_iterate_internal_links_function(
+        pad, GST_DEBUG_FUNCPTR(gst_multi_kalman_iterate_internal_links));
+  }
+  gst_pad_set_chain_function(current.sink,
+                             GST_DEBUG_FUNCPTR(gst_multi_kalman_chain));
+  gst_pad_set_event_function(current.sink,
+                             GST_DEBUG_FUNCPTR(gst_multi_kalman_sink_event));
+  gst_pad_set_query_function(current.source,
+                             GST_DEBUG_FUNCPTR(gst_multi_kalman_source_query));
+  GST_PAD_SET_PROXY_CAPS(current.sink);
+  GST_PAD_SET_PROXY_ALLOCATION(current.sink);
+  GST_PAD_SET_PROXY_CAPS(current.source);
+  auto *sink{current.sink};
+  auto *source{current.source};
+  lock.unlock();
+
+  gst_element_add_pad(element_base, source);
+  gst_element_add_pad(element_base, sink);
+
+  return sink;
+}
+
+//! @brief Removes a stream and its pads.
+//!
+//! @details The waiting frame of the stream is dropped, its streaming thread
+//! released before the deactivation of the pads.
+void gst_multi_kalman_release_pad(GstElement *element_base, GstPad *pad) {
+  auto *element{GST_MULTI_KALMAN(element_base)};
+  auto &current{stream_of(pad)};
+  {
+    const std::scoped_lock lock{element->mutex};
+    current.flushing = true;
+    element->condition.notify_all();
+  }
+
+  auto *source{current.source};
+  gst_pad_set_active(pad, false);
+  gst_pad_set_active(source, false);
+  gst_element_remove_pad(element_base, source);
+  gst_element_remove_pad(element_base, pad);
+
+  const std::scoped_lock lock{element->mutex};
+  std::erase_if(element->streams,
+                [&current](const auto &other) { return &other == &current; });
+  element->condition.notify_all();
+}
+
+//! @brief Returns whether every awaited stream has a frame waiting for the
+//! time slot.
+//!
+//! @details The negotiated streams neither ended nor flushing are awaited.
+auto complete(const GstMultiKalman *element) -> bool {
+  return std::ranges::all_of(element->streams, [](const auto &current) {
+    return current.pending || !current.negotiated || current.ended ||
+           current.flushing;
+  });
+}
+
+//! @brief The update of the tiles of the filters of a plane of a frame.
+struct job {
+  //! @brief The filters of the plane.
+  fcarouge::pixel_kalman *filter{nullptr};
+
+  //! @brief The plane of eight bits samples, if any.
+  fcarouge::plane<guint8> narrow;
+
+  //! @brief The plane of sixteen bits samples, if any.
+  fcarouge::plane<guint16> wide;
+
+  //! @brief Whether the samples are sixteen bits wide.
+  bool wide_samples{false};
+
+  //! @brief The first task of the tiles of the plane among all the tasks.
+  std::size_t first_task{0};
+};
+
+//! @brief Filters the frames of the streams of a time slot.
+//!
+//! @details The filters of the new streams are initialized from their frame.
+//! The tiles of the planes of all the other frames are then updated in one
+//! run of the shared workers, the tiles of a plane in consecutive tasks.
+void filter(GstMultiKalman *element, std::span<stream *const> slot) {
+  const fcarouge::pixel_kalman::configuration parameters{
+      element->p, element->r, element->shared_covariance, element->precision};
+  auto &pool{*element->pool};
+  std::vector<job> jobs;
+  std::size_t tasks{0};
+  for (auto *current : slot) {
+    const auto wide_samples{fcarouge::sample_size(&current->info) ==
+                            sizeof(guint16)};
+    const auto planes{GST_VIDEO_INFO_N_PLANES(&current->info)};
+    for (guint index{0}; index < planes; ++index) {
+      auto &plane_filter{current->filters[index]};
+      job plane_job{&plane_filter, {}, {}, wide_samples, tasks};
+      if (wide_samples) {
+        plane_job.wide = fcarouge::view<guint16>(&current->frame, index);
+      } else {
+        plane_job.narrow = fcarouge::view<guint8>(&current->frame, index);
+      }
+      if (current->reset) {
+        if (wide_samples) {
+          plane_filter.initialize(plane_job.wide, parameters, pool);
+        } else {
+          plane_filter.initialize(plane_job.narrow, parameters, pool);
+        }
+        continue;
+      }
+      if (!element->shared_covariance) {
+        plane_filter.diverge();
+      }
+      plane_filter.prepare(1, pool);
+      tasks += plane_filter.tiles();
+      jobs.push_back(plane_job);
+    }
+    current->reset = false;
+  }
+
+  GST_LOG_OBJECT(element, "Filtering %zu frames in %zu tasks.", slot.size(),
+                 tasks);
+  pool.run(tasks, [&jobs](std::size_t task) {
+    const auto &owner{*std::prev(std::ranges::upper_bound(
+        jobs, task, std::ranges::less{}, &job::first_task))};
+    const auto tile{task - owner.first_task};
+    if (owner.wide_samples) {
+      owner.filter->update(std::span{&owner.wide, 1},
+                           fcarouge::resolution::full, tile);
+    } else {
+      owner.filter->update(std::span{&owner.narrow, 1},
+                           fcarouge::resolution::full, tile);
+    }
+  });
+}
+
+//! @brief Filters the waiting frames of the time slot.
+//!
+//! @details The frames are filtered without the lock, while the other
+//! streams queue their frames for the next time slot.
+void filter_slot(GstMultiKalman *element,
+                 std::unique_lock<std::mutex> &lock) {
+  std::vector<stream *> slot;
+  for (auto &current : element->streams) {
+    if (current.pending && !current.filtered && !current.flushing) {
+      current.scheduled = true;
+      slot.push_back(&current);
+    }
+  }
+  element->busy = true;
+  lock.unlock();
+
+  filter(element, slot);
+
+  lock.lock();
+  for (auto *current : slot) {
+    current->scheduled = false;
+    current->filtered = true;
+  }
+  element->busy = false;
+  element->condition.notify_all();
+}
+
+//! @brief Filters a frame of a stream in its time slot and pushes it.
+//!
+//! @details The frame waits for the frames of the other streams, up to the
+//! slot duration. The streaming thread completing the time slot, or the
+//! first to wait for the slot duration, filters all the waiting frames. The
+//! other streaming threads push their filtered frame.
+auto gst_multi_kalman_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer)
+    -> GstFlowReturn {
+  auto *element{GST_MULTI_KALMAN(parent)};
+  auto &current{stream_of(pad)};
+  if (!current.negotiated) {
+    gst_buffer_unref(buffer);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  auto *writable{gst_buffer_make_writable(buffer)};
+  GstVideoFrame frame;
+  const auto mapped{gst_video_frame_map(&frame, &current.info, writable,
+                                        GST_MAP_READWRITE)};
+  gst_buffer_unref(writable);
+  g_return_val_if_fail(mapped, GST_FLOW_ERROR);
+
+  std::unique_lock lock{element->mutex};
+  current.frame = frame;
+  current.pending = true;
+  current.filtered = false;
+  element->condition.notify_all();
+  const auto deadline{std::chrono::steady_clock::now() +
+                      std::chrono::nanoseconds{element->slot_duration}};
+  while (!current.filtered && !(current.flushing && !current.scheduled)) {
+    if (element->busy) {
+      element->condition.wait(lock);
+    } else if (complete(element) ||
+               std::chrono::steady_clock::now() >= deadline) {
+      filter_slot(element, lock);
+    } else {
+      element->condition.wait_until(lock, deadline);
+    }
+  }
+  const auto filtered{current.filtered};
+  current.pending = false;
+  current.filtered = false;
+  auto *source{GST_PAD(gst_object_ref(current.source))};
+  lock.unlock();
+
+  auto *output{gst_buffer_ref(frame.buffer)};
+  gst_video_frame_unmap(&frame);
+  auto status{GST_FLOW_FLUSHING};
+  if (filtered) {
+    status = gst_pad_push(source, output);
+  } else {
+    gst_buffer_unref(output);
+  }
+  gst_object_unref(source);
+
+  return status;
+}
+
+//! @brief Negotiates the streams and tracks their flushes and ends.
+//!
+//! @details The filters of a stream are allocated on negotiation of new video
+//! information, at the native resolution of its planes, and initialized from
+//! its next frame. An ended or flushing stream is no longer awaited by the
+//! time slots. The events are forwarded to the source pad of the stream.
+auto gst_multi_kalman_sink_event(GstPad *pad, GstObject *parent,
+                                 GstEvent *event) -> gboolean {
+  auto *element{GST_MULTI_KALMAN(parent)};
+  auto &current{stream_of(pad)};
+  switch (GST_EVENT_TYPE(event)) {
+  case GST_EVENT_CAPS: {
+    GstCaps *negotiated{nullptr};
+    gst_event_parse_caps(event, &negotiated);
+    GstVideoInfo information;
+    if (!gst_video_info_from_caps(&information, negotiated)) {
+      gst_event_unref(event);
+      return false;
+    }
+    const std::scoped_lock lock{element->mutex};
+    if (!current.negotiated ||
+        !gst_video_info_is_equal(&current.info, &information)) {
+      fcarouge::resize(current.filters, &information, element->tile_size,
+                       element->granularity);
+      current.info = information;
+      current.reset = true;
+    }
+    current.negotiated = true;
+    break;
+  }
+  case GST_EVENT_FLUSH_START: {
+    const std::scoped_lock lock{element->mutex};
+    current.flushing = true;
+    element->condition.notify_all();
+    break;
+  }
+  case GST_EVENT_FLUSH_STOP: {
+    const std::scoped_lock lock{element->mutex};
+    current.flushing = false;
+    current.ended = false;
+    break;
+  }
+  case GST_EVENT_STREAM_START: {
+    const std::scoped_lock lock{element->mutex};
+    current.ended = false;
+    break;
+  }
+  case GST_EVENT_EOS: {
+    const std::scoped_lock lock{element->mutex};
+    current.ended = true;
+    element->condition.notify_all();
+    break;
+  }
+  default:
+    break;
+  }
+
+  return gst_pad_event_default(pad, parent, event);
+}
+
+//! @brief Adds the slot duration to the upstream latency of the stream.
+auto gst_multi_kalman_source_query(GstPad *pad, GstObject *parent,
+                                   GstQuery *query) -> gboolean {
+  if (!gst_pad_query_default(pad, parent, query)) {
+    return false;
+  }
+
+  if (GST_QUERY_TYPE(query) == GST_QUERY_LATENCY) {
+    const auto latency{GST_MULTI_KALMAN(parent)->slot_duration};
+    gboolean live{false};
+    GstClockTime minimum{0};
+    GstClockTime maximum{GST_CLOCK_TIME_NONE};
+    gst_query_parse_latency(query, &live, &minimum, &maximum);
+    minimum += latency;
+    if (GST_CLOCK_TIME_IS_VALID(maximum)) {
+      maximum += latency;
+    }
+    gst_query_set_latency(query, live, minimum, maximum);
+  }
+
+  return true;
+}
+
+//! @brief Links the sink and source pads of each stream, and only them.
+auto gst_multi_kalman_iterate_internal_links(GstPad *pad, GstObject *parent)
+    -> GstIterator * {
+  static_cast<void>(parent);
+
+  const auto &current{stream_of(pad)};
+  GValue value = G_VALUE_INIT;
+  g_value_init(&value, GST_TYPE_PAD);
+  g_value_set_object(&value,
+                     pad == current.sink ? current.source : current.sink);
+  auto *iterator{gst_iterator_new_single(GST_TYPE_PAD, &value)};
+  g_value_unset(&value);
+
+  return iterator;
+}
+
+} // namespace
+
+GST_ELEMENT_REGISTER_DEFINE(multikalman, name.data(), GST_RANK_NONE,
+                            gst_multi_kalman_get_type());
@@ -0,0 +1,247 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The conversions of the reduced precision floating-point storage.
+
+#ifndef FCAROUGE_HALF_FLOAT_HPP
+#define FCAROUGE_HALF_FLOAT_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
+
+namespace fcarouge {
+
+//! @brief Converts a single precision value to IEEE half precision, rounding
+//! to the nearest even.
+//!
+//! @details Overflows to infinity, converts the not-a-numbers to the canonical
+//! quiet not-a-number, and rounds the small values to the subnormals, without
+//! branches on the common normal values.
+[[nodiscard]] constexpr auto to_half(float value) noexcept -> std::uint16_t {
+  const auto bits{std::bit_cast<std::uint32_t>(value)};
+  const auto sign{(bits >> 16) & 0x8000U};
+  auto magnitude{bits & 0x7FFFFFFFU};
+  if (magnitude >= 0x47800000U) {
+    return static_cast<std::uint16_t>(
+        sign | (magnitude > 0x7F800000U ? 0x7E00U : 0x7C00U));
+  }
+  if (magnitude < 0x38800000U) {
+    const auto subnormal{std::bit_cast<std::uint32_t>(
+        std::bit_cast<float>(magnitude) + 0.5F)};
+    return static_cast<std::uint16_t>(sign | (subnormal - 0x3F000000U));
+  }
+  const auto odd{(magnitude >> 13) & 1U};
+  magnitude += 0xC8000FFFU + odd;
+  return static_cast<std::uint16_t>(sign | (magnitude >> 13));
+}
+
+//! @brief Converts an IEEE half precision value to single precision, exactly.
+[[nodiscard]] constexpr auto from_half(std::uint16_t value) noexcept -> float {
+  constexpr std::uint32_t exponent_mask{0x7C00U << 13};
+  auto bits{(value & 0x7FFFU) << 13};
+  const auto exponent{bits & exponent_mask};
+  bits += (127U - 15U) << 23;
+  if (exponent == exponent_mask) {
+    bits += (128U - 16U) << 23;
+  } else if (exponent == 0) {
+    bits += 1U << 23;
+    bits = std::bit_cast<std::uint32_t>(std::bit_cast<float>(bits) -
+                                        std::bit_cast<float>(113U << 23));
+  }
+  return std::bit_cast<float>(bits | ((value & 0x8000U) << 16));
+}
+
+//! @brief Converts a single precision value to bfloat16, rounding to the
+//! nearest even.
+[[nodiscard]] constexpr auto to_bfloat(float value) noexcept -> std::uint16_t {
+  const auto bits{std::bit_cast<std::uint32_t>(value)};
+  const auto rounded{(bits + 0x7FFFU + ((bits >> 16) & 1U)) >> 16};
+  const auto quieted{(bits >> 16) | 0x40U};
+  const auto magnitude{std::bit_cast<std::int32_t>(bits & 0x7FFFFFFFU)};
+  return static_cast<std::uint16_t>(magnitude > 0x7F800000 ? quieted
+                                                           : rounded);
+}
+
+//! @brief Converts a bfloat16 value to single precision, exactly.
+[[nodiscard]] constexpr auto from_bfloat(std::uint16_t value) noexcept
+    -> float {
+  return std::bit_cast<float>(static_cast<std::uint32_t>(value) << 16);
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+//! @brief Returns whether the processor converts half precision values.
+[[nodiscard]] inline auto f16c() noexcept -> bool {
+  static const bool supported{__builtin_cpu_supports("f16c") != 0};
+  return supported;
+}
+
+//! @brief Converts the half precision values with the F16C instructions,
+//! eight at a time.
+__attribute__((target("avx,f16c"))) inline void
+widen_f16c(const std::uint16_t *values, float *results, std::size_t count) {
+  std::size_t index{0};
+  for (; index + 8 <= count; index += 8) {
+    _mm256_storeu_ps(results + index,
+                     _mm256_cvtph_ps(_mm_loadu_si128(
+                         reinterpret_cast<const __m128i *>(values + index))));
+  }
+  for (; index < count; ++index) {
+    results[index] = from_half(values[index]);
+  }
+}
+
+//! @brief Converts the single precision values with the F16C instructions,
+//! eight at a time, rounding to the nearest even.
+__attribute__((target("avx,f16c"))) inline void
+narrow_f16c(const float *values, std::uint16_t *results, std::size_t count) {
+  std::size_t index{0};
+  for (; index + 8 <= count; index += 8) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(results + index),
+                     _mm256_cvtps_ph(_mm256_loadu_ps(values + index),
+                                     _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; index < count; ++index) {
+    results[index] = to_half(values[index]);
+  }
+}
+#endif
+
+//! @brief Converts the half precision values to single precision.
+//!
+//! @details Uses the F16C instructions where the processor has them.
+inline void widen_half(const std::uint16_t *values, float *results,
+                       std::size_t count) {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  if (f16c()) {
+    widen_f16c(values, results, count);
+    return;
+  }
+#endif
+  for (std::size_t index{0}; index < count; ++index) {
+    results[index] = from_half(values[index]);
+  }
+}
+
+//! @brief Converts the single precision values to half precision.
+//!
+//! @details Uses the F16C instructions where the processor has them, which
+//! keep the truncated payload of the not-a-numbers. The other values convert
+//! bit for bit as the scalar conversion.
+inline void narrow_half(const float *values, std::uint16_t *results,
+                        std::size_t count) {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  if (f16c()) {
+    narrow_f16c(values, results, count);
+    return;
+  }
+#endif
+  for (std::size_t index{0}; index < count; ++index) {
+    results[index] = to_half(values[index]);
+  }
+}
+
+//! @brief Converts the bfloat16 values to single precision.
+//!
+//! @details Eight at a time with the baseline SSE2 instructions of the 64 bits
+//! x86 processors, interleaving the values above zero low halves.
+inline void widen_bfloat(const std::uint16_t *values, float *results,
+                         std::size_t count) {
+  std::size_t index{0};
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  const auto zero{_mm_setzero_si128()};
+  for (; index + 8 <= count; index += 8) {
+    const auto value{
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + index))};
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(results + index),
+                     _mm_unpacklo_epi16(zero, value));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(results + index + 4),
+                     _mm_unpackhi_epi16(zero, value));
+  }
+#endif
+  for (; index < count; ++index) {
+    results[index] = from_bfloat(values[index]);
+  }
+}
+
+//! @brief Converts the single precision values to bfloat16, rounding to the
+//! nearest even.
+//!
+//! @details Eight at a time with the baseline SSE2 instructions, as the scalar
+//! conversion. The arithmetic shift keeps the high halves within the signed
+//! saturation of the packing.
+inline void narrow_bfloat(const float *values, std::uint16_t *results,
+                          std::size_t count) {
+  std::size_t index{0};
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  const auto half_ulp{_mm_set1_epi32(0x7FFF)};
+  const auto one{_mm_set1_epi32(1)};
+  const auto quiet{_mm_set1_epi32(0x40)};
+  const auto magnitude{_mm_set1_epi32(0x7FFFFFFF)};
+  const auto infinity{_mm_set1_epi32(0x7F800000)};
+  const auto narrow{[&](__m128i bits) {
+    const auto odd{_mm_and_si128(_mm_srli_epi32(bits, 16), one)};
+    const auto rounded{_mm_srai_epi32(
+        _mm_add_epi32(bits, _mm_add_epi32(half_ulp, odd)), 16)};
+    const auto quieted{_mm_or_si128(_mm_srai_epi32(bits, 16), quiet)};
+    const auto nan{
+        _mm_cmpgt_epi32(_mm_and_si128(bits, magnitude), infinity)};
+    return _mm_or_si128(_mm_and_si128(nan, quieted),
+                        _mm_andnot_si128(nan, rounded));
+  }};
+  for (; index + 8 <= count; index += 8) {
+    const auto low{narrow(_mm_castps_si128(_mm_loadu_ps(values + index)))};
+    const auto high{
+        narrow(_mm_castps_si128(_mm_loadu_ps(values + index + 4)))};
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(results + index),
+                     _mm_packs_epi32(low, high));
+  }
+#endif
+  for (; index < count; ++index) {
+    results[index] = to_bfloat(values[index]);
+  }
+}
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_HALF_FLOAT_HPP
@@ -0,0 +1,169 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The bounded queue of the jobs of a dedicated thread.
+
+#ifndef FCAROUGE_OUTPUT_STAGE_HPP
+#define FCAROUGE_OUTPUT_STAGE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace fcarouge {
+
+//! @brief A dedicated thread processing the queued jobs in order.
+//!
+//! @details The producer waits while the queue is full, bounding the jobs in
+//! flight to the depth of the queue and the job being processed. While
+//! flushing, the queued jobs are handed back to the producer, and new jobs
+//! refused, for the producer to release them.
+template <typename Job> class output_stage {
+public:
+  //! @brief Starts the thread processing the jobs with the function.
+  template <typename Function>
+  output_stage(std::size_t depth, Function function)
+      : capacity{std::max(depth, std::size_t{1})},
+        thread{[this, function](std::stop_token stop) mutable {
+          process(stop, function);
+        }} {}
+
+  output_stage(const output_stage &other) = delete;
+  auto operator=(const output_stage &other) -> output_stage & = delete;
+
+  //! @brief Stops the thread after the job being processed.
+  //!
+  //! @details The queued jobs are dropped unprocessed, taken beforehand by
+  //! flushing for their resources to be released.
+  ~output_stage() {
+    thread.request_stop();
+    thread.join();
+  }
+
+  //! @brief Queues the job, waiting while the queue is full.
+  //!
+  //! @details Returns whether the job was queued, refused while flushing.
+  [[nodiscard]] auto push(Job job) -> bool {
+    {
+      std::unique_lock lock{mutex};
+      condition.wait(lock,
+                     [this] { return flushing || jobs.size() < capacity; });
+      if (flushing) {
+        return false;
+      }
+      jobs.push_back(std::move(job));
+    }
+    condition.notify_all();
+
+    return true;
+  }
+
+  //! @brief Waits for the queued jobs and the job being processed.
+  void flush() {
+    std::unique_lock lock{mutex};
+    condition.wait(lock, [this] { return jobs.empty() && !busy; });
+  }
+
+  //! @brief Starts or stops flushing.
+  //!
+  //! @details Returns the queued jobs dropped on start, and wakes the
+  //! producer waiting for room in the queue.
+  auto set_flushing(bool value) -> std::deque<Job> {
+    std::deque<Job> dropped;
+    {
+      const std::scoped_lock lock{mutex};
+      flushing = value;
+      if (value) {
+        std::swap(dropped, jobs);
+      }
+    }
+    condition.notify_all();
+
+    return dropped;
+  }
+
+private:
+  //! @brief Processes the queued jobs in order until stopped.
+  template <typename Function>
+  void process(std::stop_token stop, Function &function) {
+    std::unique_lock lock{mutex};
+    while (condition.wait(lock, stop, [this] { return !jobs.empty(); })) {
+      auto job{std::move(jobs.front())};
+      jobs.pop_front();
+      busy = true;
+      lock.unlock();
+      condition.notify_all();
+      function(job);
+      lock.lock();
+      busy = false;
+      condition.notify_all();
+    }
+  }
+
+  //! @brief The guard of the queue and of the state of the stage.
+  std::mutex mutex;
+
+  //! @brief The notification of the queued, taken, and processed jobs.
+  std::condition_variable_any condition;
+
+  //! @brief The queued jobs, oldest first.
+  std::deque<Job> jobs;
+
+  //! @brief The greatest number of queued jobs.
+  std::size_t capacity;
+
+  //! @brief Whether a job is being processed.
+  bool busy{false};
+
+  //! @brief Whether the jobs are refused.
+  bool flushing{false};
+
+  //! @brief The thread, declared last to start after the other members are
+  //! initialized and stop before they are destroyed.
+  std::jthread thread;
+};
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_OUTPUT_STAGE_HPP
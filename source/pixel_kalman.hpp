@@ -0,0 +1,1506 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The per-pixel Kalman filter engine of the video plugin element.
+
+#ifndef FCAROUGE_PIXEL_KALMAN_HPP
+#define FCAROUGE_PIXEL_KALMAN_HPP
+
+#include "half_float.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fcarouge {
+
+//! @brief A view of a plane of samples of a video frame.
+//!
+//! @details The samples of a row are contiguous, the rows are strided. A plane
+//! of interleaved components, for example of packed RGBA or semi-planar
+//! chrominance, is viewed as rows of all their samples. A plane filtered out
+//! of place reads its samples from the rows of another plane of the same
+//! geometry.
+template <typename Pixel> struct plane {
+  //! @brief The first sample of the first row.
+  Pixel *data{nullptr};
+
+  //! @brief The number of samples of a row.
+  std::size_t width{0};
+
+  //! @brief The number of rows.
+  std::size_t height{0};
+
+  //! @brief The distance between the first samples of two rows, in samples.
+  std::size_t stride{0};
+
+  //! @brief The greatest value of a sample, for example 1023 for 10 bits.
+  Pixel maximum{std::numeric_limits<Pixel>::max()};
+
+  //! @brief The first input sample of the first row, if filtered out of
+  //! place, otherwise the samples are filtered in place.
+  const Pixel *source{nullptr};
+
+  //! @brief The distance between the first input samples of two rows, in
+  //! samples.
+  std::size_t source_stride{0};
+
+  //! @brief Returns the number of samples of the plane.
+  [[nodiscard]] constexpr auto size() const noexcept -> std::size_t {
+    return width * height;
+  }
+
+  //! @brief Returns the samples of a row.
+  [[nodiscard]] constexpr auto row(std::size_t index) const noexcept
+      -> std::span<Pixel> {
+    return {data + index * stride, width};
+  }
+
+  //! @brief Copies the input samples of the rows to the plane, if filtered out
+  //! of place.
+  //!
+  //! @details Called by the workers on their tile right before filtering it,
+  //! for the samples to be read from the input once and filtered while cache
+  //! resident.
+  constexpr void load(std::size_t first, std::size_t last) const noexcept {
+    if (source == nullptr) {
+      return;
+    }
+    for (auto index{first}; index < last; ++index) {
+      std::copy_n(source + index * source_stride, width, data + index * stride);
+    }
+  }
+};
+
+//! @brief An allocator of over-aligned storage.
+//!
+//! @details Aligns the filter state arrays on cache lines for the benefit of
+//! the vectorized kernels and to avoid false sharing between workers. The
+//! values are default-initialized, leaving the pages of trivial values
+//! untouched until the workers first write their tiles.
+template <typename Type, std::size_t Alignment = 64> struct aligned_allocator {
+  using value_type = Type;
+
+  template <typename Other> struct rebind {
+    using other = aligned_allocator<Other, Alignment>;
+  };
+
+  constexpr aligned_allocator() noexcept = default;
+
+  template <typename Other>
+  constexpr explicit aligned_allocator(
+      const aligned_allocator<Other, Alignment> &other) noexcept {
+    static_cast<void>(other);
+  }
+
+  [[nodiscard]] auto allocate(std::size_t count) -> Type * {
+    return static_cast<Type *>(
+        ::operator new(count * sizeof(Type), std::align_val_t{Alignment}));
+  }
+
+  void deallocate(Type *pointer, std::size_t count) noexcept {
+    ::operator delete(pointer, count * sizeof(Type),
+                      std::align_val_t{Alignment});
+  }
+
+  template <typename Other, typename... Arguments>
+  void construct(Other *pointer, Arguments &&...arguments) {
+    if constexpr (sizeof...(Arguments) == 0) {
+      ::new (static_cast<void *>(pointer)) Other;
+    } else {
+      ::new (static_cast<void *>(pointer))
+          Other(std::forward<Arguments>(arguments)...);
+    }
+  }
+
+  template <typename Other>
+  constexpr auto
+  operator==(const aligned_allocator<Other, Alignment> &other) const noexcept
+      -> bool {
+    static_cast<void>(other);
+    return true;
+  }
+};
+
+//! @brief The spatial resolution of an update.
+enum class resolution {
+  //! @brief Every filter is updated with its sample.
+  full,
+
+  //! @brief A filter per block of two by two pixels is updated with the mean
+  //! of the block samples, its estimate shared by the block.
+  half
+};
+
+//! @brief The representation of the state estimates.
+enum class precision {
+  //! @brief Single precision floating-point estimates.
+  single,
+
+  //! @brief Signed 16 bits fixed-point estimates with a shared gain.
+  fixed,
+
+  //! @brief IEEE half precision floating-point storage of the estimates and
+  //! uncertainties, computed in single precision.
+  half,
+
+  //! @brief Bfloat16 floating-point storage of the estimates and
+  //! uncertainties, computed in single precision.
+  bfloat
+};
+
+//! @brief Per-pixel, single precision, no input, constant system dynamic model
+//! Kalman filters.
+//!
+//! @details The state estimate and estimate uncertainty of each pixel are held
+//! in contiguous, aligned arrays. The model is shared by all pixels and held
+//! once. The update is the scalar form of the `fcarouge::kalman` Joseph form
+//! update, evaluated in the same order, for bit-identical estimates.
+//!
+//! With the constant, input-free model, filters initialized with the same
+//! uncertainty share the same uncertainty and gain sequences. In the shared
+//! mode, the uncertainty and gain recursion is advanced once per frame and the
+//! gain applied to every pixel with a multiply-add. The per-pixel uncertainties
+//! are materialized when the filters diverge.
+//!
+//! In the fixed-point precision, the estimates of samples up to 10 bits are
+//! held as Q(15-b) signed 16 bits words of b integer bits, 7 fractional bits
+//! for 8 bits samples, and corrected with the shared gain rounded to Q15. The
+//! correction rounds to the nearest and the output truncates as the single
+//! precision path does. Each frame adds at most 2^-(16-b) from the correction
+//! rounding and 2^(b-16) from the gain rounding to the estimate error, about
+//! 0.0078 for 8 bits samples, and the previous error decays by 1-k. The error
+//! of an output sample is then at most one code value while the accumulated
+//! error stays under one.
+//!
+//! In the half and bfloat16 precisions, the estimates and uncertainties are
+//! stored in 16 bits, for half the state traffic and footprint, and widened
+//! to single precision by rows for the same computations. An estimate moves
+//! only by corrections of at least half its spacing, 1/16 in half precision
+//! and 1/2 in bfloat16 for samples of 128 to 255, 4 times as much for 10 bits
+//! samples, the estimates of converged filters then lagging small changes.
+//!
+//! Under load, the filters may be updated at half resolution, by blocks of two
+//! by two pixels, or pass their estimates through without update.
+//!
+//! With a granularity, a filter is held per square block of pixels, per
+//! component, for a fraction of the state footprint and arithmetic. It is
+//! updated with the rounded mean of the block samples and its estimate
+//! written to every sample of the block, in the same pass over the rows of the
+//! block. The filters of blocks are not further halved under load, nor
+//! skipped by regions, their macroblocks all flagged as changed.
+//!
+//! The rows are split in regions of macroblocks of pixels. With a change
+//! threshold, the regions of converged filters whose samples all stay within
+//! the threshold of their estimates are skipped, their estimates passed
+//! through. The macroblocks of each row whose samples departed from their
+//! estimates are flagged in the same pass, for the change maps. A skipped
+//! frame is taken as an update with no innovation: the estimates are
+//! unchanged and the shared uncertainty advances, while the per-pixel
+//! uncertainties of a region catch up in closed form when the region is next
+//! updated.
+struct pixel_kalman {
+  //! @brief The type of the state, uncertainty, and model values.
+  using value_type = float;
+
+  //! @brief The type of the aligned per-pixel arrays.
+  using storage = std::vector<value_type, aligned_allocator<value_type>>;
+
+  //! @brief The type of the fixed-point estimates and gain.
+  using fixed_type = std::int16_t;
+
+  //! @brief The type of the aligned per-pixel fixed-point arrays.
+  using fixed_storage = std::vector<fixed_type, aligned_allocator<fixed_type>>;
+
+  //! @brief The type of the aligned per-pixel half precision or bfloat16
+  //! arrays.
+  using reduced_storage =
+      std::vector<std::uint16_t, aligned_allocator<std::uint16_t>>;
+
+  //! @brief The initialization parameters of the filters.
+  struct configuration {
+    //! @brief The initial estimate uncertainty.
+    value_type p{1.F};
+
+    //! @brief The observation, measurement noise uncertainty.
+    value_type r{0.F};
+
+    //! @brief Whether the estimate uncertainty is shared by all pixels.
+    bool shared{true};
+
+    //! @brief The requested representation of the estimates.
+    //!
+    //! @details The fixed-point precision requires the shared uncertainty and
+    //! samples of at most 10 bits, and the half precision samples of at most
+    //! 11 bits, otherwise the single precision is used.
+    precision estimate{precision::single};
+
+    //! @brief The process noise uncertainty per unit of elapsed time of the
+    //! predictions.
+    value_type q{0.F};
+  };
+
+  //! @brief The greatest number of bits of the samples of fixed-point filters.
+  static constexpr int fixed_bits{10};
+
+  //! @brief The greatest number of bits of the samples of half precision
+  //! filters, the estimates of wider samples overflowing to infinity.
+  static constexpr int half_bits{11};
+
+  //! @brief The number of pixels of a row of a macroblock of the change maps.
+  static constexpr std::size_t macroblock_pixels{16};
+
+  //! @brief The number of macroblocks of a region of a row.
+  static constexpr std::size_t region_macroblocks{4};
+
+  //! @brief The greatest number of interleaved components of a pixel.
+  static constexpr std::size_t maximum_components{4};
+
+  //! @brief The greatest gain of converged filters, the estimate then
+  //! weighing at least as much as the measurement.
+  static constexpr value_type converged_gain{0.5F};
+
+  //! @brief The single precision state estimate of each pixel, X.
+  storage x;
+
+  //! @brief The fixed-point state estimate of each pixel, X.
+  fixed_storage fixed_x;
+
+  //! @brief The number of fractional bits of the fixed-point estimates, or
+  //! zero for the single precision estimates.
+  int fraction{0};
+
+  //! @brief The estimate uncertainty of each pixel, P, unless shared.
+  storage p;
+
+  //! @brief The reduced precision state estimate of each pixel, X.
+  reduced_storage reduced_x;
+
+  //! @brief The reduced precision estimate uncertainty of each pixel, P,
+  //! unless shared.
+  reduced_storage reduced_p;
+
+  //! @brief The reduced precision of the stored estimates and uncertainties,
+  //! or the single precision.
+  precision reduction{precision::single};
+
+  //! @brief The estimate uncertainty shared by all pixels, P, when shared.
+  value_type shared_p{0.F};
+
+  //! @brief Whether the estimate uncertainty is shared by all pixels.
+  bool shared{false};
+
+  //! @brief The shared observation, measurement noise uncertainty, R.
+  value_type r{0.F};
+
+  //! @brief The shared process noise uncertainty, Q, per unit of elapsed time
+  //! of the predictions.
+  value_type q{0.F};
+
+  //! @brief The shared state transition, F.
+  value_type f{1.F};
+
+  //! @brief The shared observation transition, H.
+  value_type h{1.F};
+
+  //! @brief The number of filtered samples per row.
+  std::size_t width{0};
+
+  //! @brief The number of filtered rows.
+  std::size_t height{0};
+
+  //! @brief The number of interleaved samples of a pixel.
+  std::size_t components{1};
+
+  //! @brief The number of rows of a tile, the unit of work of the workers.
+  std::size_t tile_rows{1};
+
+  //! @brief The number of pixels of the side of the square blocks of pixels
+  //! sharing a filter, one for a filter per pixel, two, or four.
+  std::size_t granularity{1};
+
+  //! @brief Whether the estimates of the blocks of two by two pixels are held
+  //! by their top left filter, after half resolution updates.
+  bool blocks{false};
+
+  //! @brief The shared gains of the frames of the current update.
+  std::vector<value_type> gains;
+
+  //! @brief The process noise uncertainties predicted before each frame of
+  //! the current update.
+  std::vector<value_type> noises;
+
+  //! @brief The greatest innovation of the samples of a skipped region, zero
+  //! to update every region.
+  value_type threshold{0.F};
+
+  //! @brief The number of consecutive frames each region of each row was
+  //! skipped, zero for a region updated with the last frame.
+  std::vector<std::uint32_t> idle;
+
+  //! @brief The number of samples each tile updated in the last update.
+  std::vector<std::size_t> updates;
+
+  //! @brief The number of frames of the last update.
+  std::size_t updated_frames{0};
+
+  //! @brief Whether the updates flag the changed macroblocks of each row.
+  bool mapping{false};
+
+  //! @brief Whether each macroblock of each row of each frame of the last
+  //! update changed, nonzero for a change.
+  std::vector<std::uint8_t> changes;
+
+  //! @brief Returns the number of filters of a row of the state, per block
+  //! of pixels and component.
+  [[nodiscard]] auto columns() const noexcept -> std::size_t {
+    const auto pixels{width / components};
+    return (pixels + granularity - 1) / granularity * components;
+  }
+
+  //! @brief Returns the number of rows of the state.
+  [[nodiscard]] auto rows() const noexcept -> std::size_t {
+    return (height + granularity - 1) / granularity;
+  }
+
+  //! @brief Returns the number of filters.
+  [[nodiscard]] auto size() const noexcept -> std::size_t {
+    return columns() * rows();
+  }
+
+  //! @brief Returns whether the estimates are held in fixed-point.
+  [[nodiscard]] auto fixed() const noexcept -> bool { return fraction != 0; }
+
+  //! @brief Returns whether the estimates and uncertainties are stored in
+  //! reduced precision.
+  [[nodiscard]] auto reduced() const noexcept -> bool {
+    return reduction != precision::single;
+  }
+
+  //! @brief Converts a value to the reduced precision storage.
+  [[nodiscard]] auto narrow(value_type value) const noexcept -> std::uint16_t {
+    return reduction == precision::half ? to_half(value) : to_bfloat(value);
+  }
+
+  //! @brief Converts a value of the reduced precision storage.
+  [[nodiscard]] auto widen(std::uint16_t value) const noexcept -> value_type {
+    return reduction == precision::half ? from_half(value)
+                                        : from_bfloat(value);
+  }
+
+  //! @brief Converts the values to the reduced precision storage.
+  void narrow(const value_type *values, std::uint16_t *results,
+              std::size_t count) const {
+    if (reduction == precision::half) {
+      narrow_half(values, results, count);
+    } else {
+      narrow_bfloat(values, results, count);
+    }
+  }
+
+  //! @brief Converts the values of the reduced precision storage.
+  void widen(const std::uint16_t *values, value_type *results,
+             std::size_t count) const {
+    if (reduction == precision::half) {
+      widen_half(values, results, count);
+    } else {
+      widen_bfloat(values, results, count);
+    }
+  }
+
+  //! @brief Applies the function to the single precision estimates and
+  //! uncertainties of the samples from the state offset, the uncertainties
+  //! null when shared.
+  //!
+  //! @details The reduced precision state is widened to the scratch arrays of
+  //! the calling thread for the function, and narrowed back if written.
+  template <typename Function>
+  void widened(std::size_t offset, std::size_t count, bool write,
+               Function function) {
+    if (!reduced()) {
+      function(x.data() + offset, shared ? nullptr : p.data() + offset);
+      return;
+    }
+    thread_local storage widened_x;
+    thread_local storage widened_p;
+    if (widened_x.size() < count) {
+      widened_x.resize(count);
+      widened_p.resize(count);
+    }
+    widen(reduced_x.data() + offset, widened_x.data(), count);
+    if (!shared) {
+      widen(reduced_p.data() + offset, widened_p.data(), count);
+    }
+    function(widened_x.data(), shared ? nullptr : widened_p.data());
+    if (write) {
+      narrow(widened_x.data(), reduced_x.data() + offset, count);
+      if (!shared) {
+        narrow(widened_p.data(), reduced_p.data() + offset, count);
+      }
+    }
+  }
+
+  //! @brief Returns the single precision estimates of the samples from the
+  //! state offset.
+  //!
+  //! @details The reduced precision estimates are widened to the scratch array
+  //! of the calling thread, valid until the next call.
+  [[nodiscard]] auto estimates_at(std::size_t offset, std::size_t count) const
+      -> const value_type * {
+    if (!reduced()) {
+      return x.data() + offset;
+    }
+    thread_local storage widened_estimates;
+    if (widened_estimates.size() < count) {
+      widened_estimates.resize(count);
+    }
+    widen(reduced_x.data() + offset, widened_estimates.data(), count);
+    return widened_estimates.data();
+  }
+
+  //! @brief Returns the reduced precision of the storage of the
+  //! configuration for samples up to the maximum, or the single precision.
+  [[nodiscard]] static constexpr auto
+  reduction_of(const configuration &parameters, unsigned maximum) noexcept
+      -> precision {
+    const auto bits{static_cast<int>(std::bit_width(maximum))};
+    return (parameters.estimate == precision::half && bits <= half_bits) ||
+                   parameters.estimate == precision::bfloat
+               ? parameters.estimate
+               : precision::single;
+  }
+
+  //! @brief Returns the number of fractional bits of the fixed-point
+  //! estimates of the configuration for samples up to the maximum, or zero
+  //! for the single precision estimates.
+  [[nodiscard]] static auto fraction_bits(const configuration &parameters,
+                                          unsigned maximum) noexcept -> int {
+    const auto bits{static_cast<int>(std::bit_width(maximum))};
+    return parameters.estimate == precision::fixed && parameters.shared &&
+                   bits <= fixed_bits
+               ? std::numeric_limits<fixed_type>::digits - bits
+               : 0;
+  }
+
+  //! @brief Sets the geometry of the filters of a plane of samples.
+  //!
+  //! @details The plane is split in tiles of whole rows of about the number
+  //! of samples, a multiple of the rows of the blocks of the granularity and
+  //! of the half resolution updates, for the blocks to stay within their
+  //! tile. The state is allocated on initialization from the first frame, in
+  //! the representation of the configuration.
+  void resize(std::size_t samples_width, std::size_t samples_height,
+              std::size_t tile_samples, std::size_t pixel_components = 1,
+              std::size_t block_side = 1) {
+    width = samples_width;
+    height = samples_height;
+    components = pixel_components;
+    granularity = block_side;
+    const auto block_rows{std::max(std::size_t{2}, granularity)};
+    tile_rows = std::max(std::size_t{1},
+                         tile_samples / std::max(width, std::size_t{1}));
+    tile_rows = (tile_rows + block_rows - 1) / block_rows * block_rows;
+    idle.assign(height * regions(), 0);
+    updates.assign(tiles(), 0);
+    changes.clear();
+    storage{}.swap(x);
+    fixed_storage{}.swap(fixed_x);
+    storage{}.swap(p);
+    reduced_storage{}.swap(reduced_x);
+    reduced_storage{}.swap(reduced_p);
+  }
+
+  //! @brief Returns the number of samples of a macroblock of a row.
+  [[nodiscard]] auto macroblock_samples() const noexcept -> std::size_t {
+    return macroblock_pixels * components;
+  }
+
+  //! @brief Returns the number of macroblocks of a row.
+  [[nodiscard]] auto macroblocks_width() const noexcept -> std::size_t {
+    return (width + macroblock_samples() - 1) / macroblock_samples();
+  }
+
+  //! @brief Returns the number of regions of a row.
+  [[nodiscard]] auto regions() const noexcept -> std::size_t {
+    return (macroblocks_width() + region_macroblocks - 1) / region_macroblocks;
+  }
+
+  //! @brief Returns the change flags of the macroblocks of the rows of a
+  //! frame of the last update or estimate.
+  [[nodiscard]] auto changed(std::size_t frame) const noexcept
+      -> std::span<const std::uint8_t> {
+    return std::span{changes}.subspan(frame * height * macroblocks_width(),
+                                      height * macroblocks_width());
+  }
+
+  //! @brief Returns the fraction of the samples updated by the last update,
+  //! the others skipped.
+  [[nodiscard]] auto updated() const noexcept -> double {
+    const auto total{size() * updated_frames};
+    return total != 0
+               ? static_cast<double>(std::accumulate(
+                     std::begin(updates), std::end(updates), std::size_t{0})) /
+                     static_cast<double>(total)
+               : 1.;
+  }
+
+  //! @brief Resets the filters with the plane samples as initial estimates.
+  //!
+  //! @details The estimates are initialized from the samples, or the means of
+  //! the samples of their blocks, the uncertainties and the observation noise
+  //! from the configuration, in a single parallel pass over the allocated
+  //! state. The samples are unchanged, or copied from their input if filtered
+  //! out of place. The uncertainty is either shared or held per pixel. The
+  //! tiles of the state are first touched by their workers.
+  template <typename Pixel>
+  void initialize(const plane<Pixel> &samples, const configuration &parameters,
+                  worker_pool &pool) {
+    r = parameters.r;
+    q = parameters.q;
+    shared_p = parameters.p;
+    shared = parameters.shared;
+    blocks = false;
+    std::fill(std::begin(idle), std::end(idle), 0);
+    if (mapping) {
+      changes.assign(height * macroblocks_width(), 1);
+    }
+    fraction = fraction_bits(parameters, samples.maximum);
+    reduction = reduction_of(parameters, samples.maximum);
+    allocate();
+
+    for_each_row(pool, [this, &samples, &parameters](std::size_t index) {
+      samples.load(index * granularity,
+                   std::min((index + 1) * granularity, height));
+      const auto row{measure(samples, index)};
+      const auto offset{static_cast<std::ptrdiff_t>(index * columns())};
+      if (fixed()) {
+        std::transform(std::begin(row), std::end(row),
+                       std::begin(fixed_x) + offset, [this](Pixel sample) {
+                         return static_cast<fixed_type>(sample << fraction);
+                       });
+      } else if (reduced()) {
+        std::transform(std::begin(row), std::end(row),
+                       std::begin(reduced_x) + offset, [this](Pixel sample) {
+                         return narrow(static_cast<value_type>(sample));
+                       });
+      } else {
+        std::copy(std::begin(row), std::end(row), std::begin(x) + offset);
+      }
+      if (!shared && reduced()) {
+        std::fill_n(std::begin(reduced_p) + offset, columns(),
+                    narrow(parameters.p));
+      } else if (!shared) {
+        std::fill_n(std::begin(p) + offset, columns(), parameters.p);
+      }
+    });
+  }
+
+  //! @brief Allocates the state arrays of the representation and releases
+  //! the others.
+  void allocate() {
+    storage{}.swap(x);
+    fixed_storage{}.swap(fixed_x);
+    reduced_storage{}.swap(reduced_x);
+    storage{}.swap(p);
+    reduced_storage{}.swap(reduced_p);
+    if (fixed()) {
+      fixed_x.resize(size());
+    } else if (reduced()) {
+      reduced_x.resize(size());
+    } else {
+      x.resize(size());
+    }
+    if (!shared && reduced()) {
+      reduced_p.resize(size());
+    } else if (!shared) {
+      p.resize(size());
+    }
+  }
+
+  //! @brief Materializes the per-pixel uncertainties of shared filters.
+  //!
+  //! @details Called before the filters of the pixels diverge, for example on
+  //! partial reset or partial update. The fixed-point estimates are converted
+  //! to single precision, exactly.
+  void diverge() {
+    if (fixed()) {
+      x.resize(size());
+      const value_type scale{1.F / static_cast<value_type>(1 << fraction)};
+      std::transform(std::begin(fixed_x), std::end(fixed_x), std::begin(x),
+                     [scale](fixed_type estimate) {
+                       return static_cast<value_type>(estimate) * scale;
+                     });
+      fixed_storage{}.swap(fixed_x);
+      fraction = 0;
+    }
+    if (shared) {
+      if (reduced()) {
+        reduced_p.assign(size(), narrow(shared_p));
+      } else {
+        p.assign(size(), shared_p);
+      }
+      std::fill(std::begin(idle), std::end(idle), 0);
+      shared = false;
+    }
+  }
+
+  //! @brief Shares the greatest per-pixel uncertainty by all pixels.
+  //!
+  //! @details Called before the filters are updated with the shared gain, for
+  //! example under load. The greatest uncertainty is the most conservative,
+  //! its gain the fastest to follow the measurements. The filters diverge
+  //! again on request.
+  void converge() {
+    if (shared) {
+      return;
+    }
+    if (reduced()) {
+      // The encodings of the positive values are ordered as the values.
+      shared_p = reduced_p.empty()
+                     ? shared_p
+                     : widen(*std::max_element(reduced_p.begin(),
+                                               reduced_p.end()));
+      reduced_storage{}.swap(reduced_p);
+    } else {
+      shared_p = p.empty() ? shared_p : *std::max_element(p.begin(), p.end());
+      storage{}.swap(p);
+    }
+    std::fill(std::begin(idle), std::end(idle), 0);
+    shared = true;
+  }
+
+  //! @brief Writes the estimates to the plane samples without update.
+  //!
+  //! @details Every sample is written, the input samples of a plane filtered
+  //! out of place are not read.
+  template <typename Pixel>
+  void estimate(const plane<Pixel> &samples, worker_pool &pool) {
+    if (mapping) {
+      changes.assign(height * macroblocks_width(), 0);
+    }
+    const auto maximum{samples.maximum};
+    const int shift{fraction};
+    for_each_tile(pool, [this, &samples, maximum,
+                         shift](std::size_t first, std::size_t last) {
+      if (granularity != 1) {
+        for (auto index{first}; index < last; index += granularity) {
+          const auto row{scratch<Pixel>()};
+          estimate(row, index / granularity * columns(), maximum);
+          upsample(samples, index / granularity, row);
+        }
+        return;
+      }
+      for (auto index{first}; index < last; ++index) {
+        if (blocks && index % 2 != 0) {
+          continue;
+        }
+        auto *const row{samples.row(index).data()};
+        const auto offset{index * width};
+        if (blocks) {
+          auto *const bottom{samples.row(index + below(index)).data()};
+          const auto *const values{fixed() ? nullptr
+                                           : estimates_at(offset, width)};
+          for_each_block([this, row, bottom, offset, values, maximum,
+                          shift](std::size_t left, std::size_t right) {
+            const auto output{
+                fixed() ? static_cast<Pixel>(std::min(
+                              fixed_x[offset + left] >> shift, int{maximum}))
+                        : clamp(values[left], maximum)};
+            row[left] = row[right] = bottom[left] = bottom[right] = output;
+          });
+        } else {
+          estimate(samples, index, index + 1, 0, width);
+        }
+      }
+    });
+  }
+
+  //! @brief Writes the estimates of the region of rows and columns to the
+  //! plane samples without update.
+  template <typename Pixel>
+  void estimate(const plane<Pixel> &samples, std::size_t first,
+                std::size_t last, std::size_t column, std::size_t count) {
+    for (auto index{first}; index < last; ++index) {
+      estimate(samples.row(index).subspan(column, count),
+               index * width + column, samples.maximum);
+    }
+  }
+
+  //! @brief Writes the estimates of the filters from the state offset to the
+  //! row of samples.
+  template <typename Pixel>
+  void estimate(std::span<Pixel> row, std::size_t offset,
+                Pixel maximum) const {
+    const auto count{row.size()};
+    if (fixed()) {
+      const int shift{fraction};
+      const auto *const estimates{fixed_x.data() + offset};
+      for (std::size_t sample{0}; sample < count; ++sample) {
+        row[sample] = static_cast<Pixel>(
+            std::min(estimates[sample] >> shift, int{maximum}));
+      }
+    } else {
+      const auto *const values{estimates_at(offset, count)};
+      for (std::size_t sample{0}; sample < count; ++sample) {
+        row[sample] = clamp(values[sample], maximum);
+      }
+    }
+  }
+
+  //! @brief Returns the measurements of the filters of a row of the state.
+  //!
+  //! @details The samples of the row for the filters of pixels. The rounded
+  //! means of the samples of the blocks, per component, for the filters of
+  //! blocks, in the scratch row of the calling thread. The rows of the blocks
+  //! are summed in a vectorizable loop, then the columns of the blocks. The
+  //! missing pixels of the last blocks of the rows and columns are left out
+  //! of their means.
+  template <typename Pixel>
+  [[nodiscard]] auto measure(const plane<Pixel> &samples,
+                             std::size_t index) const -> std::span<Pixel> {
+    if (granularity == 1) {
+      return samples.row(index);
+    }
+    thread_local std::vector<std::uint32_t> sums;
+    sums.resize(width);
+    const auto top{index * granularity};
+    const auto bottom{std::min(top + granularity, height)};
+    const auto first{samples.row(top)};
+    std::copy(std::begin(first), std::end(first), std::begin(sums));
+    for (auto current{top + 1}; current < bottom; ++current) {
+      const auto *const values{samples.row(current).data()};
+      for (std::size_t sample{0}; sample < width; ++sample) {
+        sums[sample] += values[sample];
+      }
+    }
+
+    const auto means{scratch<Pixel>()};
+    if (granularity == 2) {
+      reduce<2>(sums.data(), means.data(), bottom - top);
+    } else {
+      reduce<4>(sums.data(), means.data(), bottom - top);
+    }
+    return means;
+  }
+
+  //! @brief Reduces the column sums of the samples of a row of blocks of the
+  //! side to the rounded means of the blocks.
+  //!
+  //! @details The means of the whole blocks of the rows divide by a power of
+  //! two.
+  template <std::size_t Side, typename Pixel>
+  void reduce(const std::uint32_t *sums, Pixel *means,
+              std::size_t block_rows) const {
+    const auto pixels{width / components};
+    const auto whole{pixels / Side};
+    const auto mean{[block_rows](std::uint32_t sum, std::size_t count) {
+      const auto total{static_cast<std::uint32_t>(block_rows * count)};
+      return static_cast<Pixel>((sum + total / 2) / total);
+    }};
+    const auto sum{[sums, this](std::size_t block, std::size_t component,
+                                std::size_t count) {
+      std::uint32_t result{0};
+      for (std::size_t pixel{0}; pixel < count; ++pixel) {
+        result += sums[(block * Side + pixel) * components + component];
+      }
+      return result;
+    }};
+    if (block_rows == Side && components == 1) {
+      constexpr auto shift{2 * std::countr_zero(Side)};
+      for (std::size_t block{0}; block < whole; ++block) {
+        means[block] = static_cast<Pixel>(
+            (sum(block, 0, Side) + (1U << (shift - 1))) >> shift);
+      }
+    } else {
+      for (std::size_t block{0}; block < whole; ++block) {
+        for (std::size_t component{0}; component < components; ++component) {
+          means[block * components + component] =
+              mean(sum(block, component, Side), Side);
+        }
+      }
+    }
+    if (const auto rest{pixels - whole * Side}; rest != 0) {
+      for (std::size_t component{0}; component < components; ++component) {
+        means[whole * components + component] =
+            mean(sum(whole, component, rest), rest);
+      }
+    }
+  }
+
+  //! @brief Writes the outputs of the filters of a row of the state to the
+  //! samples of their blocks.
+  //!
+  //! @details The first row of the blocks is written and copied to their
+  //! other rows. The outputs of the filters of pixels are already in place.
+  template <typename Pixel>
+  void upsample(const plane<Pixel> &samples, std::size_t index,
+                std::span<const std::type_identity_t<Pixel>> outputs) const {
+    if (granularity == 1) {
+      return;
+    }
+    const auto top{index * granularity};
+    const auto bottom{std::min(top + granularity, height)};
+    auto *const first{samples.row(top).data()};
+    if (granularity == 2) {
+      spread<2>(outputs.data(), first);
+    } else {
+      spread<4>(outputs.data(), first);
+    }
+    for (auto current{top + 1}; current < bottom; ++current) {
+      std::copy_n(first, width, samples.row(current).data());
+    }
+  }
+
+  //! @brief Writes the outputs of the filters of a row of blocks of the side
+  //! to each pixel of their blocks, in a row of samples.
+  template <std::size_t Side, typename Pixel>
+  void spread(const Pixel *outputs, Pixel *row) const {
+    const auto pixels{width / components};
+    if (components == 1) {
+      const auto whole{pixels / Side};
+      for (std::size_t block{0}; block < whole; ++block) {
+        for (std::size_t pixel{0}; pixel < Side; ++pixel) {
+          row[block * Side + pixel] = outputs[block];
+        }
+      }
+      if (whole * Side != pixels) {
+        std::fill(row + whole * Side, row + pixels, outputs[whole]);
+      }
+      return;
+    }
+    for (std::size_t pixel{0}; pixel < pixels; pixel += Side) {
+      const auto *const output{outputs + pixel / Side * components};
+      const auto count{std::min(Side, pixels - pixel)};
+      for (auto *sample{row + pixel * components};
+           sample < row + (pixel + count) * components;
+           sample += components) {
+        for (std::size_t component{0}; component < components; ++component) {
+          sample[component] = output[component];
+        }
+      }
+    }
+  }
+
+  //! @brief Returns a row of samples of the filters of a row of the state, in
+  //! the scratch storage of the calling thread, valid until the next call.
+  template <typename Pixel>
+  [[nodiscard]] auto scratch() const -> std::span<Pixel> {
+    thread_local std::vector<Pixel> row;
+    row.resize(columns());
+    return row;
+  }
+
+  //! @brief Copies the estimates of the top left filters of the blocks to the
+  //! other filters of the blocks, after half resolution updates.
+  void expand(worker_pool &pool) {
+    if (!blocks) {
+      return;
+    }
+    blocks = false;
+    for_each_tile(pool, [this](std::size_t first, std::size_t last) {
+      for (auto index{first}; index < last; index += 2) {
+        const auto upper{index * width};
+        const auto lower{upper + below(index) * width};
+        const auto copy{[upper, lower](auto *estimates) {
+          return [estimates, upper, lower](std::size_t left,
+                                           std::size_t right) {
+            estimates[upper + right] = estimates[lower + left] =
+                estimates[lower + right] = estimates[upper + left];
+          };
+        }};
+        if (fixed()) {
+          for_each_block(copy(fixed_x.data()));
+        } else if (reduced()) {
+          for_each_block(copy(reduced_x.data()));
+        } else {
+          for_each_block(copy(x.data()));
+        }
+      }
+    });
+  }
+
+  //! @brief Updates the filters with the plane samples and writes the
+  //! estimates back.
+  //!
+  //! @details The tiles of rows are filtered in-place and in parallel. The
+  //! samples of a row are filtered in a vectorizable loop over the contiguous
+  //! state. The shared uncertainty and gain are advanced once for the frame.
+  //! The filters of the blocks of half resolution updates are expanded before
+  //! a full resolution update. The filters are first predicted over the
+  //! elapsed time, if any.
+  template <typename Pixel>
+  void update(const plane<Pixel> &samples, worker_pool &pool,
+              resolution detail = resolution::full, value_type elapsed = 0.F) {
+    update(std::span{&samples, 1}, pool, detail,
+           std::span<const value_type>{&elapsed, 1});
+  }
+
+  //! @brief Updates the filters with consecutive frames of the plane, tile by
+  //! tile, and writes the estimates back.
+  //!
+  //! @details Each tile of the state is updated with all the frames before
+  //! the next tile, the state of the tile staying cache resident across the
+  //! frames. The estimates are identical to updating frame by frame. The
+  //! shared uncertainty and gains are advanced beforehand, once per frame.
+  //! The half resolution updates require the shared gain. Each frame is
+  //! predicted over its elapsed time since the previous frame, if any.
+  template <typename Pixel>
+  void update(std::span<const plane<Pixel>> frames, worker_pool &pool,
+              resolution detail = resolution::full,
+              std::span<const value_type> elapsed = {}) {
+    prepare(frames.size(), pool, detail, elapsed);
+    pool.run(tiles(), [this, frames, detail](std::size_t tile) {
+      update(frames, detail, tile);
+    });
+  }
+
+  //! @brief Prepares the update of the tiles with consecutive frames.
+  //!
+  //! @details Predicts and advances the shared uncertainty and gains once per
+  //! frame. The tiles are then updated independently, possibly among the
+  //! tiles of other filters.
+  //!
+  //! The prediction of the constant, identity transition model over an
+  //! elapsed time t is in closed form: the estimates are unchanged and the
+  //! uncertainties grow by Q t, for any number of frames, whole or not. The
+  //! per-pixel uncertainties grow in the update pass of the frame.
+  void prepare(std::size_t frames, worker_pool &pool,
+               resolution detail = resolution::full,
+               std::span<const value_type> elapsed = {}) {
+    if (detail == resolution::half && granularity == 1) {
+      converge();
+      blocks = true;
+    } else {
+      expand(pool);
+    }
+    noises.assign(frames, 0.F);
+    for (std::size_t frame{0}; frame < std::min(frames, elapsed.size());
+         ++frame) {
+      noises[frame] = q * elapsed[frame];
+    }
+    if (fixed() || shared) {
+      gains.resize(frames);
+      for (std::size_t frame{0}; frame < frames; ++frame) {
+        shared_p += noises[frame];
+        gains[frame] = gain(shared_p, h, r);
+      }
+    }
+
+    updated_frames = frames;
+    if (mapping) {
+      changes.resize(frames * height * macroblocks_width());
+      if (detail == resolution::half || granularity != 1) {
+        std::fill(std::begin(changes), std::end(changes), 1);
+      }
+    }
+  }
+
+  //! @brief Returns the number of tiles of rows of the filters.
+  [[nodiscard]] auto tiles() const noexcept -> std::size_t {
+    return (height + tile_rows - 1) / tile_rows;
+  }
+
+  //! @brief Updates the filters of a tile with the prepared consecutive
+  //! frames and writes the estimates back.
+  template <typename Pixel>
+  void update(std::span<const plane<Pixel>> frames, resolution detail,
+              std::size_t tile) {
+    const auto first{tile * tile_rows};
+    const auto last{std::min(first + tile_rows, height)};
+    const auto sparse{threshold > 0.F && detail == resolution::full};
+    std::size_t updated{0};
+    for (std::size_t frame{0}; frame < frames.size(); ++frame) {
+      const auto &samples{frames[frame]};
+      samples.load(first, last);
+      const value_type k{fixed() || shared ? gains[frame] : 0.F};
+      const auto noise{noises[frame]};
+      if (granularity != 1) {
+        for (auto index{first}; index < last; index += granularity) {
+          const auto row{measure(samples, index / granularity)};
+          update(row, index / granularity * columns(), k, noise,
+                 samples.maximum);
+          upsample(samples, index / granularity, row);
+        }
+        updated += (last - first + granularity - 1) / granularity * columns();
+        continue;
+      }
+      if (detail == resolution::half) {
+        for (auto index{first}; index < last; index += 2) {
+          update_blocks(samples, index, k);
+        }
+        updated += (last - first) * width / 4;
+        continue;
+      }
+      const auto detect{sparse || mapping};
+      for (auto index{first}; index < last; ++index) {
+        auto *const flags{
+            mapping ? changes.data() +
+                          (frame * height + index) * macroblocks_width()
+                    : nullptr};
+        for (std::size_t region{0}; region < regions(); ++region) {
+          const auto length{region_macroblocks * macroblock_samples()};
+          const auto column{region * length};
+          const auto count{std::min(length, width - column)};
+          const auto moved{detect ? moving(samples, index, column, count)
+                                  : ~0U};
+          if (mapping) {
+            flag(flags + region * region_macroblocks, count, moved);
+          }
+          auto &skipped{idle[index * regions() + region]};
+          if (sparse && moved == 0 && converged(index, column, k)) {
+            estimate(samples, index, index + 1, column, count);
+            predict(index * width + column, count, noise);
+            ++skipped;
+            continue;
+          }
+          if (skipped != 0) {
+            wake(index, column, count, skipped);
+            skipped = 0;
+          }
+          if (sparse) {
+            updated += count;
+            update(samples, index, index + 1, column, count, k, noise);
+          }
+        }
+        if (!sparse) {
+          updated += width;
+          update(samples, index, index + 1, 0, width, k, noise);
+        }
+      }
+    }
+    updates[tile] = updated;
+  }
+
+  //! @brief Updates the filters of the region of rows and columns.
+  template <typename Pixel>
+  void update(const plane<Pixel> &samples, std::size_t first,
+              std::size_t last, std::size_t column, std::size_t count,
+              value_type k, value_type noise) {
+    for (auto index{first}; index < last; ++index) {
+      update(samples.row(index).subspan(column, count),
+             index * width + column, k, noise, samples.maximum);
+    }
+  }
+
+  //! @brief Updates the filters from the state offset with a row of samples
+  //! and writes their estimates back.
+  //!
+  //! @details The per-pixel uncertainties first grow by the predicted process
+  //! noise, the shared uncertainty already grew.
+  template <typename Pixel>
+  void update(std::span<Pixel> row, std::size_t offset, value_type k,
+              value_type noise, Pixel maximum) {
+    if (fixed()) {
+      update(row, fixed_x.data() + offset, quantize(k), fraction, maximum);
+      return;
+    }
+    widened(offset, row.size(), true,
+            [this, row, k, noise, maximum](value_type *estimates,
+                                           value_type *uncertainties) {
+              if (shared) {
+                update(row, estimates, k, maximum);
+              } else {
+                update(row, estimates, uncertainties, noise, maximum);
+              }
+            });
+  }
+
+  //! @brief Grows the per-pixel uncertainties from the state offset by the
+  //! predicted process noise, for the filters skipped by the update.
+  //!
+  //! @details The skipped filters then catch up with their frames of no
+  //! innovation at once, after their process noise rather than interleaved.
+  void predict(std::size_t offset, std::size_t count, value_type noise) {
+    if (fixed() || shared || noise == 0.F) {
+      return;
+    }
+    widened(offset, count, true,
+            [count, noise](value_type *estimates, value_type *uncertainties) {
+              static_cast<void>(estimates);
+              for (std::size_t sample{0}; sample < count; ++sample) {
+                uncertainties[sample] += noise;
+              }
+            });
+  }
+
+  //! @brief Returns whether the filters of the region of the row have
+  //! converged.
+  //!
+  //! @details The filters of a region share their uncertainty history, the
+  //! gain of the first filter stands for the region.
+  [[nodiscard]] auto converged(std::size_t index, std::size_t column,
+                               value_type k) const -> bool {
+    if (!fixed() && !shared) {
+      const auto offset{index * width + column};
+      auto uncertainty{reduced() ? widen(reduced_p[offset]) : p[offset]};
+      k = gain(uncertainty, h, r);
+    }
+    return k <= converged_gain;
+  }
+
+  //! @brief Returns the mask of the macroblocks of the region of the row
+  //! whose samples departed from their estimates by more than the threshold.
+  //!
+  //! @details The samples are compared in a vectorizable loop. While mapping
+  //! the changes, the comparisons are kept and reduced by macroblocks.
+  template <typename Pixel>
+  [[nodiscard]] auto moving(const plane<Pixel> &samples, std::size_t index,
+                            std::size_t column, std::size_t count) const
+      -> unsigned {
+    const auto offset{index * width + column};
+    const auto *const row{samples.row(index).data() + column};
+    std::array<std::uint8_t, region_macroblocks * macroblock_pixels *
+                                 maximum_components>
+        moved;
+    const auto any{fixed() ? moving(row, fixed_x.data() + offset, count,
+                                    moved.data())
+                           : moving(row, estimates_at(offset, count), count,
+                                    moved.data())};
+    if (!mapping || any == 0) {
+      return any != 0 ? ~0U : 0U;
+    }
+    unsigned mask{0};
+    for (std::size_t macroblock{0}, first{0}; first < count;
+         ++macroblock, first += macroblock_samples()) {
+      const auto last{std::min(first + macroblock_samples(), count)};
+      std::uint8_t changed{0};
+      for (auto sample{first}; sample < last; ++sample) {
+        changed |= moved[sample];
+      }
+      mask |= static_cast<unsigned>(changed) << macroblock;
+    }
+    return mask;
+  }
+
+  //! @brief Compares the samples to their fixed-point estimates, returns
+  //! whether any departed by more than the threshold.
+  template <typename Pixel>
+  [[nodiscard]] auto moving(const Pixel *row, const fixed_type *estimates,
+                            std::size_t count, std::uint8_t *moved) const
+      -> std::uint8_t {
+    const int shift{fraction};
+    // Clamped for the conversion, beyond the greatest difference of samples.
+    constexpr auto greatest{
+        static_cast<value_type>(std::numeric_limits<int>::max() / 2)};
+    const auto limit{static_cast<int>(std::min(
+        threshold * static_cast<value_type>(1 << fraction), greatest))};
+    std::uint8_t any{0};
+    for (std::size_t sample{0}; sample < count; ++sample) {
+      moved[sample] =
+          std::abs((row[sample] << shift) - estimates[sample]) > limit;
+      any |= moved[sample];
+    }
+    return any;
+  }
+
+  //! @brief Compares the samples to their estimates, returns whether any
+  //! departed by more than the threshold.
+  template <typename Pixel>
+  [[nodiscard]] auto moving(const Pixel *row, const value_type *estimates,
+                            std::size_t count, std::uint8_t *moved) const
+      -> std::uint8_t {
+    const auto observation{h};
+    const auto limit{threshold};
+    std::uint8_t any{0};
+    for (std::size_t sample{0}; sample < count; ++sample) {
+      moved[sample] = std::abs(static_cast<value_type>(row[sample]) -
+                               observation * estimates[sample]) > limit;
+      any |= moved[sample];
+    }
+    return any;
+  }
+
+  //! @brief Writes the change flags of the macroblocks of a region of a row
+  //! from their mask.
+  void flag(std::uint8_t *flags, std::size_t count, unsigned mask) const {
+    const auto macroblocks{(count + macroblock_samples() - 1) /
+                           macroblock_samples()};
+    for (std::size_t macroblock{0}; macroblock < macroblocks; ++macroblock) {
+      flags[macroblock] =
+          static_cast<std::uint8_t>((mask >> macroblock) & 1U);
+    }
+  }
+
+  //! @brief Catches up the per-pixel uncertainties of the region of the row
+  //! skipped for the number of frames.
+  //!
+  //! @details The skipped frames are updates with no innovation. The
+  //! uncertainty recursion of the Joseph form, 1/P' = 1/P + H²/R, advances
+  //! the frames at once. The shared uncertainty already advanced.
+  void wake(std::size_t index, std::size_t column, std::size_t count,
+            std::uint32_t frames) {
+    if (fixed() || shared) {
+      return;
+    }
+    const auto steps{static_cast<value_type>(frames)};
+    widened(index * width + column, count, true,
+            [this, count, steps](value_type *estimates,
+                                 value_type *uncertainties) {
+              static_cast<void>(estimates);
+              for (std::size_t sample{0}; sample < count; ++sample) {
+                auto &uncertainty{uncertainties[sample]};
+                if (uncertainty > 0.F) {
+                  uncertainty =
+                      uncertainty * r / (r + steps * h * h * uncertainty);
+                }
+              }
+            });
+  }
+
+  //! @brief Predicts and updates the filters of a row of samples.
+  template <typename Pixel>
+  void update(std::span<Pixel> samples, value_type *estimates,
+              value_type *uncertainties, value_type noise,
+              Pixel maximum) const {
+    for (std::size_t index{0}; index < samples.size(); ++index) {
+      uncertainties[index] += noise;
+      samples[index] = update_pixel(estimates[index], uncertainties[index],
+                                    samples[index], h, r, maximum);
+    }
+  }
+
+  //! @brief Updates the filters of a row of samples with the shared gain.
+  template <typename Pixel>
+  void update(std::span<Pixel> samples, value_type *estimates, value_type k,
+              Pixel maximum) const {
+    for (std::size_t index{0}; index < samples.size(); ++index) {
+      samples[index] = correct(estimates[index], k, samples[index], h, maximum);
+    }
+  }
+
+  //! @brief Updates the fixed-point filters of a row of samples with the
+  //! shared Q15 gain.
+  template <typename Pixel>
+  static void update(std::span<Pixel> samples, fixed_type *estimates,
+                     fixed_type k, int shift, Pixel maximum) {
+    for (std::size_t index{0}; index < samples.size(); ++index) {
+      samples[index] =
+          correct(estimates[index], k, samples[index], shift, maximum);
+    }
+  }
+
+  //! @brief Updates the filters of the blocks of two by two pixels of the
+  //! pair of rows from the even row index, with the shared gain.
+  //!
+  //! @details The top left filter of a block is corrected with the rounded
+  //! mean of the block samples, per component, and its estimate written to
+  //! the block samples. The other filters of the block are left untouched
+  //! until expanded, for a quarter of the state traffic.
+  template <typename Pixel>
+  void update_blocks(const plane<Pixel> &samples, std::size_t index,
+                     value_type k) {
+    auto *const top{samples.row(index).data()};
+    auto *const bottom{samples.row(index + below(index)).data()};
+    const auto offset{index * width};
+    if (fixed()) {
+      const fixed_type gain_q15{quantize(k)};
+      const int shift{fraction};
+      update_blocks(top, bottom, fixed_x.data() + offset,
+                    [gain_q15, shift, &samples](fixed_type &estimate,
+                                                Pixel measurement) {
+                      return correct(estimate, gain_q15, measurement, shift,
+                                     samples.maximum);
+                    });
+    } else {
+      widened(offset, width, true,
+              [this, top, bottom, k, &samples](value_type *estimates,
+                                               value_type *uncertainties) {
+                static_cast<void>(uncertainties);
+                update_blocks(top, bottom, estimates,
+                              [this, k, &samples](value_type &estimate,
+                                                  Pixel measurement) {
+                                return correct(estimate, k, measurement, h,
+                                               samples.maximum);
+                              });
+              });
+    }
+  }
+
+  //! @brief Updates the blocks of the rows of samples with the correction
+  //! function of a top left estimate and block mean measurement.
+  template <typename Pixel, typename Estimate, typename Correct>
+  void update_blocks(Pixel *top, Pixel *bottom, Estimate *estimates,
+                     Correct correction) {
+    for_each_block([top, bottom, estimates, &correction](std::size_t left,
+                                                         std::size_t right) {
+      const auto sum{static_cast<unsigned>(top[left] + top[right] +
+                                           bottom[left] + bottom[right])};
+      const auto output{
+          correction(estimates[left], static_cast<Pixel>((sum + 2) / 4))};
+      top[left] = top[right] = bottom[left] = bottom[right] = output;
+    });
+  }
+
+  //! @brief Returns one if the row index has a row below, zero otherwise.
+  //!
+  //! @details The missing bottom row of the blocks of an odd plane repeats the
+  //! top row.
+  [[nodiscard]] auto below(std::size_t index) const noexcept -> std::size_t {
+    return index + 1 < height ? 1 : 0;
+  }
+
+  //! @brief Applies the function to the left and right offsets of the samples
+  //! of each block of two by two pixels of a row, per component.
+  //!
+  //! @details The missing right column of the last blocks of an odd row
+  //! repeats the left column, for the same mean.
+  template <typename Function> void for_each_block(Function function) const {
+    const auto block{2 * components};
+    const auto paired{width / block * block};
+    for (std::size_t pixel{0}; pixel < paired; pixel += block) {
+      for (auto left{pixel}; left < pixel + components; ++left) {
+        function(left, left + components);
+      }
+    }
+    for (auto left{paired}; left < width; ++left) {
+      function(left, left);
+    }
+  }
+
+  //! @brief Updates a single filter and returns its clamped pixel estimate.
+  template <typename Pixel>
+  [[nodiscard]] static constexpr auto
+  update_pixel(value_type &estimate, value_type &uncertainty, Pixel measurement,
+               value_type observation, value_type noise, Pixel maximum)
+      -> Pixel {
+    return correct(estimate, gain(uncertainty, observation, noise),
+                   measurement, observation, maximum);
+  }
+
+  //! @brief Advances an estimate uncertainty and returns the Kalman gain.
+  //!
+  //! @details The scalar Joseph form update is evaluated term for term as by
+  //! the general library. The identity products are exact and vanish. A
+  //! certain estimate of a noiseless output, of zero innovation uncertainty,
+  //! is kept with a zero gain rather than the library's not-a-number.
+  [[nodiscard]] static constexpr auto gain(value_type &uncertainty,
+                                           value_type observation,
+                                           value_type noise) -> value_type {
+    const value_type s{observation * uncertainty * observation + noise};
+    const value_type k{s > 0.F ? uncertainty * observation / s : 0.F};
+    uncertainty = (1.F - k * observation) * uncertainty *
+                      (1.F - k * observation) +
+                  k * noise * k;
+    return k;
+  }
+
+  //! @brief Rounds a gain in the unit range to Q15.
+  [[nodiscard]] static auto quantize(value_type k) -> fixed_type {
+    constexpr value_type one{1 << 15};
+    return static_cast<fixed_type>(
+        std::clamp(std::lround(k * one), 0L,
+                   long{std::numeric_limits<fixed_type>::max()}));
+  }
+
+  //! @brief Corrects a fixed-point estimate with the Q15 gain and returns its
+  //! saturated pixel.
+  //!
+  //! @details The innovation and correction fit 16 bits lanes. The correction
+  //! is the rounding high half multiplication of the gain and innovation.
+  template <typename Pixel>
+  [[nodiscard]] static constexpr auto correct(fixed_type &estimate,
+                                              fixed_type k, Pixel measurement,
+                                              int shift, Pixel maximum)
+      -> Pixel {
+    const auto y{static_cast<fixed_type>((measurement << shift) - estimate)};
+    const auto correction{static_cast<fixed_type>((k * y + (1 << 14)) >> 15)};
+    estimate = static_cast<fixed_type>(estimate + correction);
+    return static_cast<Pixel>(std::min(estimate >> shift, int{maximum}));
+  }
+
+  //! @brief Corrects an estimate with the gain and returns its clamped pixel.
+  template <typename Pixel>
+  [[nodiscard]] static constexpr auto correct(value_type &estimate,
+                                              value_type k, Pixel measurement,
+                                              value_type observation,
+                                              Pixel maximum) -> Pixel {
+    const value_type y{static_cast<value_type>(measurement) -
+                       observation * estimate};
+    estimate = estimate + k * y;
+    return clamp(estimate, maximum);
+  }
+
+  //! @brief Converts the estimate to the pixel type, saturating, and a
+  //! not-a-number estimate to zero.
+  template <typename Pixel>
+  [[nodiscard]] static constexpr auto clamp(value_type value, Pixel maximum)
+      -> Pixel {
+    return static_cast<Pixel>(std::min(std::max(value_type{0}, value),
+                                       static_cast<value_type>(maximum)));
+  }
+
+  //! @brief Applies the function to the first and past-the-last row indexes
+  //! of each tile, in parallel.
+  //!
+  //! @details A tile is statically assigned to the same worker frame after
+  //! frame for the plane geometry.
+  template <typename Function>
+  void for_each_tile(worker_pool &pool, Function function) {
+    pool.run(tiles(), [this, &function](std::size_t tile) {
+      const auto first{tile * tile_rows};
+      function(first, std::min(first + tile_rows, height));
+    });
+  }
+
+  //! @brief Applies the function to the indexes of the rows of the state, by
+  //! tiles, in parallel.
+  template <typename Function>
+  void for_each_row(worker_pool &pool, Function function) {
+    for_each_tile(pool, [this, &function](std::size_t first, std::size_t last) {
+      for (auto index{first}; index < last; index += granularity) {
+        function(index / granularity);
+      }
+    });
+  }
+};
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_PIXEL_KALMAN_HPP
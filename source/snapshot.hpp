@@ -0,0 +1,517 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The snapshots of the filters state in memory-mapped files.
+
+#ifndef FCAROUGE_SNAPSHOT_HPP
+#define FCAROUGE_SNAPSHOT_HPP
+
+#include "pixel_kalman.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fcarouge {
+
+//! @brief The identification of the snapshot files.
+inline constexpr std::array<char, 8> snapshot_magic{'G', 'S', 'T', 'K',
+                                                    'A', 'L', 'M', 'N'};
+
+//! @brief The version of the layout of the snapshot files, incremented on any
+//! change of the layout.
+inline constexpr std::uint32_t snapshot_version{3};
+
+//! @brief The byte order mark of the snapshot files, read back as written on
+//! hosts of the same byte order only.
+inline constexpr std::uint32_t snapshot_order{0x01020304};
+
+//! @brief The alignment of the state arrays of the snapshot files, in bytes.
+inline constexpr std::size_t snapshot_alignment{64};
+
+//! @brief The header of a snapshot file.
+//!
+//! @details The header is followed by the records of the planes and the
+//! aligned state arrays, in the host byte order.
+struct snapshot_header {
+  //! @brief The identification of the file.
+  std::array<char, 8> magic{snapshot_magic};
+
+  //! @brief The version of the layout.
+  std::uint32_t version{snapshot_version};
+
+  //! @brief The byte order mark.
+  std::uint32_t order{snapshot_order};
+
+  //! @brief The identifier of the video format of the filtered samples.
+  std::uint32_t format{0};
+
+  //! @brief The number of filtered planes.
+  std::uint32_t planes{0};
+
+  //! @brief The size of the file, in bytes.
+  std::uint64_t size{0};
+};
+
+//! @brief The record of the filters of a plane of a snapshot file.
+struct snapshot_plane {
+  //! @brief The number of filtered samples per row.
+  std::uint64_t width{0};
+
+  //! @brief The number of filtered rows.
+  std::uint64_t height{0};
+
+  //! @brief The number of interleaved samples of a pixel.
+  std::uint64_t components{0};
+
+  //! @brief The offset of the estimates, in bytes.
+  std::uint64_t estimates{0};
+
+  //! @brief The offset of the per-pixel uncertainties, in bytes, or zero when
+  //! shared.
+  std::uint64_t uncertainties{0};
+
+  //! @brief The estimate uncertainty shared by all pixels, when shared.
+  float shared_p{0.F};
+
+  //! @brief The number of fractional bits of the fixed-point estimates, or
+  //! zero for the single precision estimates.
+  std::int32_t fraction{0};
+
+  //! @brief Whether the estimate uncertainty is shared by all pixels.
+  std::uint32_t shared{0};
+
+  //! @brief Whether the estimates of the blocks of two by two pixels are held
+  //! by their top left filter.
+  std::uint32_t blocks{0};
+
+  //! @brief The reduced precision of the stored estimates and uncertainties,
+  //! or the single precision.
+  std::uint32_t reduction{0};
+
+  //! @brief The number of pixels of the side of the blocks of the filters.
+  std::uint32_t granularity{1};
+};
+
+//! @brief Returns the size of a stored estimate of the filters, in bytes.
+inline auto estimate_size(const pixel_kalman &filter) noexcept -> std::size_t {
+  if (filter.fixed()) {
+    return sizeof(pixel_kalman::fixed_type);
+  }
+  return filter.reduced() ? sizeof(std::uint16_t)
+                          : sizeof(pixel_kalman::value_type);
+}
+
+//! @brief Returns the size of a stored uncertainty of the filters, in bytes.
+inline auto uncertainty_size(const pixel_kalman &filter) noexcept
+    -> std::size_t {
+  return filter.reduced() ? sizeof(std::uint16_t)
+                          : sizeof(pixel_kalman::value_type);
+}
+
+//! @brief Returns the bytes of the stored estimates of the filters.
+template <typename Filter> auto stored_estimates(Filter &filter) noexcept {
+  using byte = std::conditional_t<std::is_const_v<Filter>, const std::byte,
+                                  std::byte>;
+  if (filter.fixed()) {
+    return reinterpret_cast<byte *>(filter.fixed_x.data());
+  }
+  return filter.reduced() ? reinterpret_cast<byte *>(filter.reduced_x.data())
+                          : reinterpret_cast<byte *>(filter.x.data());
+}
+
+//! @brief Returns the bytes of the stored uncertainties of the filters.
+template <typename Filter> auto stored_uncertainties(Filter &filter) noexcept {
+  using byte = std::conditional_t<std::is_const_v<Filter>, const std::byte,
+                                  std::byte>;
+  return filter.reduced() ? reinterpret_cast<byte *>(filter.reduced_p.data())
+                          : reinterpret_cast<byte *>(filter.p.data());
+}
+
+//! @brief Returns the offset rounded up to the alignment of the state arrays.
+constexpr auto snapshot_align(std::size_t offset) noexcept -> std::size_t {
+  return (offset + snapshot_alignment - 1) / snapshot_alignment *
+         snapshot_alignment;
+}
+
+//! @brief Writes a snapshot of the state of the filters of the planes.
+//!
+//! @details The snapshot is written to the bytes, resized as needed and their
+//! capacity kept from one snapshot to the next. The transient state, such as
+//! the skipped regions and change maps, is not kept.
+inline void capture(std::span<const pixel_kalman> filters,
+                    std::uint32_t format, std::vector<std::byte> &bytes) {
+  std::vector<snapshot_plane> records;
+  auto offset{snapshot_align(sizeof(snapshot_header) +
+                             filters.size() * sizeof(snapshot_plane))};
+  for (const auto &filter : filters) {
+    auto &record{records.emplace_back()};
+    record.width = filter.width;
+    record.height = filter.height;
+    record.components = filter.components;
+    record.shared_p = filter.shared_p;
+    record.fraction = filter.fraction;
+    record.shared = filter.shared;
+    record.blocks = filter.blocks;
+    record.reduction = static_cast<std::uint32_t>(filter.reduction);
+    record.granularity = static_cast<std::uint32_t>(filter.granularity);
+    record.estimates = offset;
+    offset = snapshot_align(offset + filter.size() * estimate_size(filter));
+    if (!filter.shared) {
+      record.uncertainties = offset;
+      const auto size{filter.size() * uncertainty_size(filter)};
+      offset = snapshot_align(offset + size);
+    }
+  }
+
+  const snapshot_header header{.format = format,
+                               .planes =
+                                   static_cast<std::uint32_t>(filters.size()),
+                               .size = offset};
+  bytes.resize(offset);
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  std::memcpy(bytes.data() + sizeof(header), records.data(),
+              records.size() * sizeof(snapshot_plane));
+  for (std::size_t index{0}; index < filters.size(); ++index) {
+    const auto &filter{filters[index]};
+    const auto &record{records[index]};
+    std::memcpy(bytes.data() + record.estimates, stored_estimates(filter),
+                filter.size() * estimate_size(filter));
+    if (!filter.shared) {
+      std::memcpy(bytes.data() + record.uncertainties,
+                  stored_uncertainties(filter),
+                  filter.size() * uncertainty_size(filter));
+    }
+  }
+}
+
+//! @brief Restores the state of the filters of the planes from a snapshot.
+//!
+//! @details The snapshot is restored when its version, byte order, video
+//! format, geometry of the planes, and representation of the estimates match
+//! the filters and configuration, otherwise the filters are unchanged. The
+//! observation and process noises are taken from the configuration. The
+//! estimates and uncertainties are read in place from the snapshot bytes by
+//! the workers, which first touch the tiles of the state. Per-pixel
+//! uncertainties converge when the configuration shares them. Returns whether
+//! the filters were restored.
+inline auto restore(std::span<const std::byte> bytes, std::uint32_t format,
+                    std::span<pixel_kalman> filters,
+                    const pixel_kalman::configuration &parameters,
+                    unsigned maximum, worker_pool &pool) -> bool {
+  snapshot_header header;
+  if (bytes.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (header.magic != snapshot_magic || header.version != snapshot_version ||
+      header.order != snapshot_order || header.format != format ||
+      header.planes != filters.size() || header.size != bytes.size() ||
+      bytes.size() <
+          sizeof(header) + filters.size() * sizeof(snapshot_plane)) {
+    return false;
+  }
+
+  std::vector<snapshot_plane> records(filters.size());
+  std::memcpy(records.data(), bytes.data() + sizeof(header),
+              records.size() * sizeof(snapshot_plane));
+  const auto fraction{pixel_kalman::fraction_bits(parameters, maximum)};
+  const auto reduction{static_cast<std::uint32_t>(
+      pixel_kalman::reduction_of(parameters, maximum))};
+  const auto within{[&bytes](std::uint64_t offset, std::size_t size) {
+    return offset % snapshot_alignment == 0 && offset <= bytes.size() &&
+           size <= bytes.size() - offset;
+  }};
+  for (std::size_t index{0}; index < filters.size(); ++index) {
+    const auto &filter{filters[index]};
+    const auto &record{records[index]};
+    const auto narrow{record.fraction != 0 || record.reduction != 0};
+    const auto estimate_bytes{narrow ? sizeof(std::uint16_t)
+                                     : sizeof(pixel_kalman::value_type)};
+    const auto uncertainty_bytes{record.reduction != 0
+                                     ? sizeof(std::uint16_t)
+                                     : sizeof(pixel_kalman::value_type)};
+    if (record.width != filter.width || record.height != filter.height ||
+        record.components != filter.components ||
+        record.granularity != filter.granularity ||
+        record.fraction != fraction || record.reduction != reduction ||
+        (record.fraction != 0 && record.shared == 0) ||
+        !within(record.estimates, filter.size() * estimate_bytes) ||
+        (record.shared == 0 &&
+         !within(record.uncertainties, filter.size() * uncertainty_bytes))) {
+      return false;
+    }
+  }
+
+  for (std::size_t index{0}; index < filters.size(); ++index) {
+    auto &filter{filters[index]};
+    const auto &record{records[index]};
+    filter.r = parameters.r;
+    filter.q = parameters.q;
+    filter.shared_p = record.shared_p;
+    filter.shared = record.shared != 0;
+    filter.blocks = record.blocks != 0;
+    filter.fraction = record.fraction;
+    filter.reduction = static_cast<precision>(record.reduction);
+    std::fill(std::begin(filter.idle), std::end(filter.idle), 0);
+    filter.allocate();
+
+    const auto *const estimates{bytes.data() + record.estimates};
+    const auto *const uncertainties{bytes.data() + record.uncertainties};
+    filter.for_each_row(pool, [&filter, estimates,
+                               uncertainties](std::size_t row) {
+      const auto count{filter.columns()};
+      const auto offset{row * count};
+      const auto estimate_bytes{estimate_size(filter)};
+      std::memcpy(stored_estimates(filter) + offset * estimate_bytes,
+                  estimates + offset * estimate_bytes, count * estimate_bytes);
+      if (!filter.shared) {
+        const auto uncertainty_bytes{uncertainty_size(filter)};
+        std::memcpy(stored_uncertainties(filter) + offset * uncertainty_bytes,
+                    uncertainties + offset * uncertainty_bytes,
+                    count * uncertainty_bytes);
+      }
+    });
+    if (parameters.shared) {
+      filter.converge();
+    }
+  }
+
+  return true;
+}
+
+//! @brief A file mapped read-only in memory.
+//!
+//! @details The mapping is empty when the file is missing, empty, or cannot be
+//! mapped, or on hosts without memory-mapped files.
+class mapped_file {
+public:
+  //! @brief Maps the file of the path.
+  explicit mapped_file(const std::string &path) {
+#if defined(__linux__)
+    const auto descriptor{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (descriptor < 0) {
+      return;
+    }
+    struct stat status {};
+    if (::fstat(descriptor, &status) == 0 && status.st_size > 0) {
+      auto *const data{::mmap(nullptr, static_cast<std::size_t>(status.st_size),
+                              PROT_READ, MAP_PRIVATE, descriptor, 0)};
+      if (data != MAP_FAILED) {
+        ::madvise(data, static_cast<std::size_t>(status.st_size),
+                  MADV_WILLNEED);
+        mapping = {static_cast<const std::byte *>(data),
+                   static_cast<std::size_t>(status.st_size)};
+      }
+    }
+    ::close(descriptor);
+#else
+    static_cast<void>(path);
+#endif
+  }
+
+  mapped_file(const mapped_file &other) = delete;
+  auto operator=(const mapped_file &other) -> mapped_file & = delete;
+
+  //! @brief Unmaps the file.
+  ~mapped_file() {
+#if defined(__linux__)
+    if (!mapping.empty()) {
+      ::munmap(const_cast<std::byte *>(mapping.data()), mapping.size());
+    }
+#endif
+  }
+
+  //! @brief Returns the mapped bytes of the file.
+  [[nodiscard]] auto bytes() const noexcept -> std::span<const std::byte> {
+    return mapping;
+  }
+
+private:
+  //! @brief The mapped bytes of the file, if any.
+  std::span<const std::byte> mapping;
+};
+
+//! @brief Writes the snapshots of the filters to files in the background.
+//!
+//! @details The snapshots are double-buffered: the state is captured in the
+//! back buffer by the streaming thread while the writer thread writes the
+//! front buffer. A snapshot is written to a temporary file then renamed over
+//! the file, for the file to always hold a whole snapshot. The pending
+//! snapshot is written before destruction.
+class snapshot_writer {
+public:
+  //! @brief Starts the writer thread.
+  snapshot_writer()
+      : thread{[this](std::stop_token stop) { write(stop); }} {}
+
+  snapshot_writer(const snapshot_writer &other) = delete;
+  auto operator=(const snapshot_writer &other) -> snapshot_writer & = delete;
+
+  //! @brief Writes the pending snapshot and stops the writer thread.
+  ~snapshot_writer() {
+    thread.request_stop();
+    thread.join();
+  }
+
+  //! @brief Captures a snapshot of the filters and queues it for writing to
+  //! the file of the path.
+  //!
+  //! @details The snapshot is dropped while the previous snapshot is still
+  //! being written, unless waiting for it. Returns whether the snapshot was
+  //! queued.
+  auto write(std::span<const pixel_kalman> filters, std::uint32_t format,
+             std::string path, bool wait = false) -> bool {
+    {
+      std::unique_lock lock{mutex};
+      if (busy && !wait) {
+        return false;
+      }
+      condition.wait(lock, [this] { return !busy; });
+    }
+
+    capture(filters, format, back);
+    {
+      const std::scoped_lock lock{mutex};
+      std::swap(back, front);
+      destination = std::move(path);
+      busy = true;
+    }
+    condition.notify_all();
+
+    return true;
+  }
+
+  //! @brief Waits for the queued snapshot to be written.
+  void flush() {
+    std::unique_lock lock{mutex};
+    condition.wait(lock, [this] { return !busy; });
+  }
+
+  //! @brief Returns the number of snapshots which failed to be written.
+  [[nodiscard]] auto failures() -> std::size_t {
+    const std::scoped_lock lock{mutex};
+    return failed;
+  }
+
+private:
+  //! @brief Writes the queued snapshots until stopped.
+  void write(std::stop_token stop) {
+    std::unique_lock lock{mutex};
+    while (condition.wait(lock, stop, [this] { return busy; })) {
+      const auto path{destination};
+      lock.unlock();
+      const auto written{store(front, path)};
+      lock.lock();
+      failed += written ? 0 : 1;
+      busy = false;
+      condition.notify_all();
+    }
+  }
+
+  //! @brief Writes the bytes to a temporary file renamed over the file of the
+  //! path. Returns whether the file was written.
+  static auto store(std::span<const std::byte> bytes, const std::string &path)
+      -> bool {
+    const auto temporary{path + ".part"};
+    {
+      std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+      file.write(reinterpret_cast<const char *>(bytes.data()),
+                 static_cast<std::streamsize>(bytes.size()));
+      if (!file.flush()) {
+        return false;
+      }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+
+    return !error;
+  }
+
+  //! @brief The guard of the buffers and of the state of the writer.
+  std::mutex mutex;
+
+  //! @brief The notification of the queued and written snapshots.
+  std::condition_variable_any condition;
+
+  //! @brief The buffer of the snapshot being captured.
+  std::vector<std::byte> back;
+
+  //! @brief The buffer of the snapshot being written.
+  std::vector<std::byte> front;
+
+  //! @brief The path of the file of the snapshot being written.
+  std::string destination;
+
+  //! @brief Whether a snapshot is queued or being written.
+  bool busy{false};
+
+  //! @brief The number of snapshots which failed to be written.
+  std::size_t failed{0};
+
+  //! @brief The writer thread, declared last to start after the other
+  //! members are initialized and stop before they are destroyed.
+  std::jthread thread;
+};
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_SNAPSHOT_HPP
@@ -0,0 +1,138 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The rolling statistics of the video plugin element.
+
+#ifndef FCAROUGE_STATISTICS_HPP
+#define FCAROUGE_STATISTICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace fcarouge {
+
+//! @brief Returns the nearest-rank percentile of the values, reordered, or
+//! zero for no values.
+//!
+//! @details The percentile is the smallest value greater than or equal to the
+//! rank percent of the values.
+template <std::random_access_iterator Iterator>
+auto nearest_rank(Iterator first, Iterator last, double rank)
+    -> std::iter_value_t<Iterator> {
+  const auto size{static_cast<std::size_t>(std::distance(first, last))};
+  if (size == 0) {
+    return std::iter_value_t<Iterator>{};
+  }
+  const auto index{std::clamp(static_cast<std::size_t>(std::ceil(
+                                  rank / 100 * static_cast<double>(size))),
+                              std::size_t{1}, size)};
+  const auto nth{first + static_cast<std::ptrdiff_t>(index - 1)};
+  std::nth_element(first, nth, last);
+  return *nth;
+}
+
+//! @brief A rolling window of the last measurements of a quantity.
+//!
+//! @details Recording overwrites the oldest measurement in constant time. The
+//! percentiles are computed on request, over a copy of the window.
+template <typename Type, std::size_t Capacity = 512> class rolling_window {
+public:
+  //! @brief Records a measurement, forgetting the oldest of a full window.
+  void push(Type value) noexcept {
+    values[next % Capacity] = value;
+    ++next;
+  }
+
+  //! @brief Returns the number of measurements of the window.
+  [[nodiscard]] auto size() const noexcept -> std::size_t {
+    return std::min(next, Capacity);
+  }
+
+  //! @brief Returns the nearest-rank percentile of the measurements of the
+  //! window, or zero for an empty window.
+  [[nodiscard]] auto percentile(double rank) const noexcept -> Type {
+    std::array<Type, Capacity> sorted;
+    const auto last{
+        std::copy_n(std::begin(values), size(), std::begin(sorted))};
+    return nearest_rank(std::begin(sorted), last, rank);
+  }
+
+  //! @brief Forgets all the measurements.
+  void clear() noexcept { next = 0; }
+
+private:
+  //! @brief The measurements, in circular order.
+  std::array<Type, Capacity> values{};
+
+  //! @brief The number of measurements recorded since cleared.
+  std::size_t next{0};
+};
+
+//! @brief The statistics of the frames filtered by the element.
+struct statistics {
+  //! @brief The number of frames filtered while collecting.
+  std::uint64_t frames{0};
+
+  //! @brief The number of initializations of the filters from a frame.
+  std::uint64_t reinitializations{0};
+
+  //! @brief The active degradation level of the filtering under load.
+  int degradation{0};
+
+  //! @brief The durations of the filtering of the frames, in nanoseconds.
+  rolling_window<std::uint64_t> kernel;
+
+  //! @brief The durations of the mapping and unmapping of the frames, in
+  //! nanoseconds.
+  rolling_window<std::uint64_t> map;
+
+  //! @brief The ratios of the busiest worker time to the mean worker time.
+  rolling_window<double> imbalance;
+
+  //! @brief The fractions of the samples updated, the others skipped.
+  rolling_window<double> updated;
+};
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_STATISTICS_HPP
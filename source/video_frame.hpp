@@ -0,0 +1,135 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The views of the planes of mapped video frames for the filters.
+
+#ifndef FCAROUGE_VIDEO_FRAME_HPP
+#define FCAROUGE_VIDEO_FRAME_HPP
+
+#include "pixel_kalman.hpp"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+namespace fcarouge {
+
+//! @brief Returns the first component of the samples of a plane.
+inline auto component(const GstVideoInfo *information, guint index) -> guint {
+  std::array<gint, GST_VIDEO_MAX_COMPONENTS> components{};
+  gst_video_format_info_component(information->finfo, index,
+                                  components.data());
+  return static_cast<guint>(components[0]);
+}
+
+//! @brief Returns the size of a sample in bytes.
+inline auto sample_size(const GstVideoInfo *information) -> std::size_t {
+  return GST_VIDEO_INFO_COMP_DEPTH(information, 0) > 8 ? sizeof(guint16)
+                                                       : sizeof(guint8);
+}
+
+//! @brief Views a plane of a mapped video frame as samples of the pixel type.
+//!
+//! @details The plane is viewed at its native, possibly subsampled, resolution
+//! with the stride of the mapped frame. The interleaved components of a plane
+//! are all viewed as samples of the row. With an input frame of the same
+//! information, possibly of other strides, the plane is filtered out of place
+//! from the input plane.
+template <typename Pixel>
+auto view(GstVideoFrame *frame, guint index,
+          const GstVideoFrame *input = nullptr) -> plane<Pixel> {
+  const auto first{component(&frame->info, index)};
+  const auto pixel_width{
+      static_cast<std::size_t>(GST_VIDEO_FRAME_COMP_WIDTH(frame, first) *
+                               GST_VIDEO_FRAME_COMP_PSTRIDE(frame, first))};
+  const auto pixel_stride{
+      static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(frame, index))};
+
+  plane<Pixel> samples{
+      static_cast<Pixel *>(GST_VIDEO_FRAME_PLANE_DATA(frame, index)),
+      pixel_width / sizeof(Pixel),
+      static_cast<std::size_t>(GST_VIDEO_FRAME_COMP_HEIGHT(frame, first)),
+      pixel_stride / sizeof(Pixel),
+      static_cast<Pixel>((1U << GST_VIDEO_FRAME_COMP_DEPTH(frame, first)) -
+                         1U)};
+  if (input != nullptr) {
+    samples.source =
+        static_cast<const Pixel *>(GST_VIDEO_FRAME_PLANE_DATA(input, index));
+    samples.source_stride =
+        static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(input, index)) /
+        sizeof(Pixel);
+  }
+
+  return samples;
+}
+
+//! @brief Sets the geometry of the filters of each plane of the video
+//! information.
+//!
+//! @details The filters of each plane are sized at the native resolution of
+//! the plane, per square block of pixels of the granularity, the filters of
+//! the missing planes released.
+inline void resize(std::span<pixel_kalman, GST_VIDEO_MAX_PLANES> filters,
+                   const GstVideoInfo *information, std::size_t tile_samples,
+                   std::size_t granularity = 1) {
+  const auto size{sample_size(information)};
+  const auto planes{GST_VIDEO_INFO_N_PLANES(information)};
+  for (guint index{0}; index < planes; ++index) {
+    const auto first{component(information, index)};
+    const auto pixel_size{static_cast<std::size_t>(
+        GST_VIDEO_INFO_COMP_PSTRIDE(information, first))};
+    filters[index].resize(
+        static_cast<std::size_t>(
+            GST_VIDEO_INFO_COMP_WIDTH(information, first)) *
+            pixel_size / size,
+        static_cast<std::size_t>(
+            GST_VIDEO_INFO_COMP_HEIGHT(information, first)),
+        tile_samples, pixel_size / size, granularity);
+  }
+  for (auto index{planes}; index < GST_VIDEO_MAX_PLANES; ++index) {
+    filters[index] = {};
+  }
+}
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_VIDEO_FRAME_HPP
@@ -0,0 +1,323 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The video filters of whole frames, independent of GStreamer.
+
+#ifndef FCAROUGE_VIDEO_KALMAN_HPP
+#define FCAROUGE_VIDEO_KALMAN_HPP
+
+#include "pixel_kalman.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace fcarouge {
+
+//! @brief The raw video formats of the filters, as the element formats.
+enum class video_format : std::uint8_t {
+  gray8,
+  gray16_le,
+  i420,
+  nv12,
+  rgba,
+  bgra,
+  i420_10le,
+  i422_10le,
+  y444_10le
+};
+
+//! @brief The geometry of a plane of a format.
+struct plane_layout {
+  //! @brief The horizontal subsampling of the pixels of the plane.
+  std::size_t horizontal{1};
+
+  //! @brief The vertical subsampling of the pixels of the plane.
+  std::size_t vertical{1};
+
+  //! @brief The number of interleaved components of a pixel of the plane.
+  std::size_t components{1};
+};
+
+//! @brief The layout of the samples of a format.
+struct format_layout {
+  //! @brief The name of the format, as the GStreamer format name.
+  std::string_view name;
+
+  //! @brief The number of bits of a sample, stored in one or two bytes, in
+  //! the host byte order.
+  unsigned depth{8};
+
+  //! @brief The number of planes.
+  std::size_t planes{1};
+
+  //! @brief The geometry of each plane.
+  std::array<plane_layout, 4> geometry{};
+
+  //! @brief Returns the number of bytes of a sample.
+  [[nodiscard]] constexpr auto sample_size() const noexcept -> std::size_t {
+    return depth > 8 ? sizeof(std::uint16_t) : sizeof(std::uint8_t);
+  }
+};
+
+//! @brief The layouts of the formats, in the order of the formats.
+inline constexpr std::array layouts{
+    format_layout{"GRAY8", 8, 1, {{{1, 1, 1}}}},
+    format_layout{"GRAY16_LE", 16, 1, {{{1, 1, 1}}}},
+    format_layout{"I420", 8, 3, {{{1, 1, 1}, {2, 2, 1}, {2, 2, 1}}}},
+    format_layout{"NV12", 8, 2, {{{1, 1, 1}, {2, 2, 2}}}},
+    format_layout{"RGBA", 8, 1, {{{1, 1, 4}}}},
+    format_layout{"BGRA", 8, 1, {{{1, 1, 4}}}},
+    format_layout{"I420_10LE", 10, 3, {{{1, 1, 1}, {2, 2, 1}, {2, 2, 1}}}},
+    format_layout{"I422_10LE", 10, 3, {{{1, 1, 1}, {2, 1, 1}, {2, 1, 1}}}},
+    format_layout{"Y444_10LE", 10, 3, {{{1, 1, 1}, {1, 1, 1}, {1, 1, 1}}}}};
+
+//! @brief Returns the layout of the samples of the format.
+[[nodiscard]] constexpr auto layout(video_format format) noexcept
+    -> const format_layout & {
+  return layouts[static_cast<std::size_t>(format)];
+}
+
+//! @brief Returns the format of the GStreamer format name, if supported.
+[[nodiscard]] constexpr auto parse_format(std::string_view name) noexcept
+    -> std::optional<video_format> {
+  for (std::size_t index{0}; index < layouts.size(); ++index) {
+    if (layouts[index].name == name) {
+      return static_cast<video_format>(index);
+    }
+  }
+  return std::nullopt;
+}
+
+//! @brief A frame of samples: the first byte and the stride, in bytes, of
+//! each plane.
+template <typename Byte> struct basic_frame {
+  //! @brief The first byte of the first row of each plane.
+  std::array<Byte *, 4> data{};
+
+  //! @brief The distance between the first bytes of two rows of each plane.
+  std::array<std::size_t, 4> strides{};
+};
+
+//! @brief A frame of samples filtered in place, or written out of place.
+using frame = basic_frame<std::byte>;
+
+//! @brief A frame of input samples read out of place.
+using const_frame = basic_frame<const std::byte>;
+
+//! @brief The Kalman filters of the samples of each plane of the frames of a
+//! format and resolution.
+//!
+//! @details The plain interface of the engine of the element, without the
+//! element adaptations to the load. The filters are initialized from the
+//! first frame, and after a reset, and updated by the subsequent frames,
+//! predicted over their elapsed time, if any. The frames are filtered
+//! together, tile by tile, by the workers.
+class video_kalman {
+public:
+  //! @brief Allocates the filters and starts the workers.
+  //!
+  //! @details Zero threads starts one worker per hardware thread.
+  video_kalman(video_format frame_format, std::size_t frame_width,
+               std::size_t frame_height,
+               const pixel_kalman::configuration &configuration,
+               std::size_t threads = 0, std::size_t tile_samples = 65536,
+               std::size_t granularity = 1)
+      : format{frame_format}, width{frame_width}, height{frame_height},
+        parameters{configuration}, pool{threads} {
+    const auto &description{layout(format)};
+    for (std::size_t index{0}; index < description.planes; ++index) {
+      filters[index].resize(plane_width(index), plane_height(index),
+                            tile_samples,
+                            description.geometry[index].components,
+                            granularity);
+    }
+  }
+
+  //! @brief Returns the number of bytes of a frame of rows without padding.
+  [[nodiscard]] auto frame_size() const noexcept -> std::size_t {
+    std::size_t size{0};
+    for (std::size_t index{0}; index < layout(format).planes; ++index) {
+      size += plane_width(index) * plane_height(index);
+    }
+    return size * layout(format).sample_size();
+  }
+
+  //! @brief Returns the frame of the bytes of rows without padding, the
+  //! planes one after the other.
+  template <typename Byte>
+  [[nodiscard]] auto packed(Byte *data) const noexcept -> basic_frame<Byte> {
+    basic_frame<Byte> result;
+    const auto size{layout(format).sample_size()};
+    for (std::size_t index{0}; index < layout(format).planes; ++index) {
+      result.data[index] = data;
+      result.strides[index] = plane_width(index) * size;
+      data += result.strides[index] * plane_height(index);
+    }
+    return result;
+  }
+
+  //! @brief Filters consecutive frames in place.
+  void filter(std::span<const frame> frames,
+              std::span<const pixel_kalman::value_type> elapsed = {}) {
+    filter(frames, {}, elapsed);
+  }
+
+  //! @brief Filters consecutive input frames out of place into the frames.
+  //!
+  //! @details The input samples are read once, by the worker of their tile,
+  //! without an input for the frames filtered in place. The elapsed time of
+  //! each frame since the previous frame, if any, is in the unit of the
+  //! process noise of the configuration.
+  void filter(std::span<const frame> frames,
+              std::span<const const_frame> inputs,
+              std::span<const pixel_kalman::value_type> elapsed = {}) {
+    if (layout(format).sample_size() == sizeof(std::uint16_t)) {
+      filter<std::uint16_t>(frames, inputs, elapsed);
+    } else {
+      filter<std::uint8_t>(frames, inputs, elapsed);
+    }
+  }
+
+  //! @brief Initializes the filters from the next frame.
+  void reset() noexcept { initialized = false; }
+
+  //! @brief Returns the filters of the planes.
+  [[nodiscard]] auto planes() noexcept -> std::span<pixel_kalman> {
+    return std::span{filters}.first(layout(format).planes);
+  }
+
+  //! @brief Returns the workers of the filters.
+  [[nodiscard]] auto workers() noexcept -> worker_pool & { return pool; }
+
+private:
+  //! @brief Returns the number of samples of a row of the plane.
+  [[nodiscard]] auto plane_width(std::size_t index) const noexcept
+      -> std::size_t {
+    const auto &geometry{layout(format).geometry[index]};
+    return (width + geometry.horizontal - 1) / geometry.horizontal *
+           geometry.components;
+  }
+
+  //! @brief Returns the number of rows of the plane.
+  [[nodiscard]] auto plane_height(std::size_t index) const noexcept
+      -> std::size_t {
+    const auto &geometry{layout(format).geometry[index]};
+    return (height + geometry.vertical - 1) / geometry.vertical;
+  }
+
+  //! @brief Views a plane of a frame as samples of the pixel type, filtered
+  //! out of place from the input frame, if any.
+  template <typename Pixel>
+  [[nodiscard]] auto view(const frame &samples, const const_frame *input,
+                          std::size_t index) const noexcept -> plane<Pixel> {
+    plane<Pixel> result{reinterpret_cast<Pixel *>(samples.data[index]),
+                        plane_width(index), plane_height(index),
+                        samples.strides[index] / sizeof(Pixel),
+                        static_cast<Pixel>((1U << layout(format).depth) - 1U)};
+    if (input != nullptr) {
+      result.source = reinterpret_cast<const Pixel *>(input->data[index]);
+      result.source_stride = input->strides[index] / sizeof(Pixel);
+    }
+    return result;
+  }
+
+  //! @brief Filters consecutive frames of samples of the pixel type.
+  template <typename Pixel>
+  void filter(std::span<const frame> frames,
+              std::span<const const_frame> inputs,
+              std::span<const pixel_kalman::value_type> elapsed) {
+    const auto input{[&inputs](std::size_t index) {
+      return index < inputs.size() ? &inputs[index] : nullptr;
+    }};
+    if (frames.empty()) {
+      return;
+    }
+    if (!initialized) {
+      for (std::size_t index{0}; index < layout(format).planes; ++index) {
+        filters[index].initialize(view<Pixel>(frames.front(), input(0), index),
+                                  parameters, pool);
+      }
+      initialized = true;
+      frames = frames.subspan(1);
+      inputs = inputs.subspan(std::min<std::size_t>(inputs.size(), 1));
+      elapsed = elapsed.subspan(std::min<std::size_t>(elapsed.size(), 1));
+    }
+
+    std::vector<plane<Pixel>> views(frames.size());
+    for (std::size_t index{0}; index < layout(format).planes; ++index) {
+      for (std::size_t image{0}; image < frames.size(); ++image) {
+        views[image] = view<Pixel>(frames[image], input(image), index);
+      }
+      filters[index].update(std::span<const plane<Pixel>>{views}, pool,
+                            resolution::full, elapsed);
+    }
+  }
+
+  //! @brief The format of the frames.
+  video_format format;
+
+  //! @brief The number of pixels of a row of the frames.
+  std::size_t width;
+
+  //! @brief The number of rows of the frames.
+  std::size_t height;
+
+  //! @brief The configuration of the filters on initialization.
+  pixel_kalman::configuration parameters;
+
+  //! @brief The workers filtering the tiles of the planes.
+  worker_pool pool;
+
+  //! @brief The filters of the samples of each plane.
+  std::array<pixel_kalman, 4> filters;
+
+  //! @brief Whether the filters are initialized.
+  bool initialized{false};
+};
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_VIDEO_KALMAN_HPP
@@ -0,0 +1,361 @@
+/*  __          _      __  __          _   _
+| |/ /    /\   | |    |  \/  |   /\   | \ | |
+| ' /    /  \  | |    | \  / |  /  \  |  \| |
+|  <    / /\ \ | |    | |\/| | / /\ \ | . ` |
+| . \  / ____ \| |____| |  | |/ ____ \| |\  |
+|_|\_\/_/    \_\______|_|  |_/_/    \_\_| \_|
+
+GStreamer Kalman Filter Video Plugin
+Version 0.1.0
+https://github.com/FrancoisCarouge/GstKalman
+
+SPDX-License-Identifier: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <https://unlicense.org> */
+
+//! @file
+//! @brief The persistent worker pool of the video plugin element.
+
+#ifndef FCAROUGE_WORKER_POOL_HPP
+#define FCAROUGE_WORKER_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fcarouge {
+
+//! @brief The number of processors addressable by the pinning of the workers.
+#if defined(__linux__)
+inline constexpr unsigned maximum_processors{CPU_SETSIZE};
+#else
+inline constexpr unsigned maximum_processors{1024};
+#endif
+
+//! @brief A pool of persistent worker threads running tiled tasks.
+//!
+//! @details The tasks of a run are statically partitioned in contiguous blocks,
+//! one per worker, such that a given task index is processed by the same
+//! worker from run to run while the number of tasks is unchanged. The state of
+//! a task stays hot in the caches of the core of its worker and is first
+//! touched on its memory node. A worker out of tasks steals the last tasks of
+//! the other workers to absorb the imbalance. The workers are optionally
+//! pinned to processors.
+class worker_pool {
+public:
+  //! @brief Starts the worker threads.
+  //!
+  //! @details Zero threads starts one worker per hardware thread. The workers
+  //! are pinned to the processors of the list, in a round-robin order, if any.
+  explicit worker_pool(std::size_t threads,
+                       std::span<const unsigned> processors = {})
+      : count{threads != 0 ? threads : hardware_threads()},
+        slots{std::make_unique<slot[]>(count)} {
+    workers.reserve(count);
+    for (std::size_t index{0}; index < count; ++index) {
+      std::optional<unsigned> processor;
+      if (!processors.empty()) {
+        processor = processors[index % processors.size()];
+      }
+      workers.emplace_back([this, index, processor](std::stop_token token) {
+        work(index, processor, token);
+      });
+    }
+  }
+
+  worker_pool(const worker_pool &) = delete;
+  worker_pool(worker_pool &&) = delete;
+  auto operator=(const worker_pool &) -> worker_pool & = delete;
+  auto operator=(worker_pool &&) -> worker_pool & = delete;
+
+  //! @brief Stops and joins the worker threads.
+  //!
+  //! @details The workers are joined first, on destruction of their threads,
+  //! their stop request interrupting their wait for a run.
+  ~worker_pool() = default;
+
+  //! @brief Returns the number of workers.
+  [[nodiscard]] auto size() const noexcept -> std::size_t { return count; }
+
+  //! @brief Enables or disables the measurement of the worker busy times.
+  //!
+  //! @details The busy times are cleared and accumulated over the following
+  //! runs while enabled. Called between runs.
+  void measure(bool enabled) noexcept {
+    timed = enabled;
+    for (std::size_t index{0}; index < count; ++index) {
+      slots[index].busy.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  //! @brief Returns the ratio of the busiest worker time to the mean worker
+  //! time of the measured runs, one for a perfect balance or no measurement.
+  [[nodiscard]] auto imbalance() const noexcept -> double {
+    std::uint64_t total{0};
+    std::uint64_t busiest{0};
+    for (std::size_t index{0}; index < count; ++index) {
+      const auto busy{slots[index].busy.load(std::memory_order_relaxed)};
+      total += busy;
+      busiest = std::max(busiest, busy);
+    }
+    if (total == 0) {
+      return 1;
+    }
+    return static_cast<double>(busiest) * static_cast<double>(count) /
+           static_cast<double>(total);
+  }
+
+  //! @brief Runs the function on each task index and waits for completion.
+  //!
+  //! @details The task `index` is first assigned to the worker
+  //! `index * size() / tasks`. The calling thread waits.
+  template <typename Function>
+  void run(std::size_t tasks, Function &&function) {
+    if (tasks == 0) {
+      return;
+    }
+    context = static_cast<void *>(&function);
+    invoke = [](void *callable, std::size_t task) {
+      (*static_cast<std::remove_reference_t<Function> *>(callable))(task);
+    };
+    for (std::size_t index{0}; index < count; ++index) {
+      slots[index].tasks.store(
+          pack(index * tasks / count, (index + 1) * tasks / count),
+          std::memory_order_relaxed);
+    }
+    pending.store(count, std::memory_order_relaxed);
+    {
+      const std::scoped_lock lock{mutex};
+      ++generation;
+    }
+    condition.notify_all();
+    for (auto remaining{pending.load(std::memory_order_acquire)};
+         remaining != 0; remaining = pending.load(std::memory_order_acquire)) {
+      pending.wait(remaining, std::memory_order_acquire);
+    }
+  }
+
+private:
+  //! @brief The remaining tasks of a worker, aligned to avoid false sharing.
+  //!
+  //! @details The first and past-the-last task indexes are packed in a single
+  //! atomic word for the owner and thieves to take from either end.
+  struct alignas(64) slot {
+    std::atomic<std::uint64_t> tasks{0};
+
+    //! @brief The measured busy time of the worker, in nanoseconds.
+    std::atomic<std::uint64_t> busy{0};
+  };
+
+  [[nodiscard]] static constexpr auto pack(std::uint64_t first,
+                                           std::uint64_t last) noexcept
+      -> std::uint64_t {
+    return first << 32U | last;
+  }
+
+  //! @brief Takes the first remaining task of the owned slot.
+  [[nodiscard]] static auto take_first(slot &from) noexcept
+      -> std::optional<std::size_t> {
+    auto tasks{from.tasks.load(std::memory_order_relaxed)};
+    while (true) {
+      const auto first{tasks >> 32U};
+      const auto last{tasks & 0xFFFFFFFFU};
+      if (first >= last) {
+        return std::nullopt;
+      }
+      if (from.tasks.compare_exchange_weak(tasks, pack(first + 1, last),
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+        return first;
+      }
+    }
+  }
+
+  //! @brief Steals the last remaining task of another slot.
+  [[nodiscard]] static auto take_last(slot &from) noexcept
+      -> std::optional<std::size_t> {
+    auto tasks{from.tasks.load(std::memory_order_relaxed)};
+    while (true) {
+      const auto first{tasks >> 32U};
+      const auto last{tasks & 0xFFFFFFFFU};
+      if (first >= last) {
+        return std::nullopt;
+      }
+      if (from.tasks.compare_exchange_weak(tasks, pack(first, last - 1),
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+        return last - 1;
+      }
+    }
+  }
+
+  //! @brief Returns the number of hardware threads, at least one.
+  [[nodiscard]] static auto hardware_threads() noexcept -> std::size_t {
+    return std::max(std::size_t{1}, static_cast<std::size_t>(
+                                        std::thread::hardware_concurrency()));
+  }
+
+  //! @brief Pins the calling thread to the processor, where supported.
+  static void pin(unsigned processor) noexcept {
+#if defined(__linux__)
+    cpu_set_t processors;
+    CPU_ZERO(&processors);
+    CPU_SET(processor, &processors);
+    static_cast<void>(pthread_setaffinity_np(pthread_self(), sizeof(processors),
+                                             &processors));
+#else
+    static_cast<void>(processor);
+#endif
+  }
+
+  //! @brief Processes the owned then stolen tasks of each run until stopped.
+  void work(std::size_t index, std::optional<unsigned> processor,
+            const std::stop_token &token) {
+    if (processor) {
+      pin(*processor);
+    }
+    std::uint64_t seen{0};
+    while (true) {
+      {
+        std::unique_lock lock{mutex};
+        if (!condition.wait(lock, token,
+                            [this, seen] { return generation != seen; })) {
+          return;
+        }
+        seen = generation;
+      }
+      const auto start{timed ? std::chrono::steady_clock::now()
+                             : std::chrono::steady_clock::time_point{}};
+      while (const auto task{take_first(slots[index])}) {
+        invoke(context, *task);
+      }
+      for (std::size_t offset{1}; offset < count; ++offset) {
+        auto &victim{slots[(index + offset) % count]};
+        while (const auto task{take_last(victim)}) {
+          invoke(context, *task);
+        }
+      }
+      if (timed) {
+        const std::chrono::nanoseconds busy{std::chrono::steady_clock::now() -
+                                            start};
+        slots[index].busy.fetch_add(static_cast<std::uint64_t>(busy.count()),
+                                    std::memory_order_relaxed);
+      }
+      if (pending.fetch_sub(1, std::memory_order_release) == 1) {
+        pending.notify_one();
+      }
+    }
+  }
+
+  //! @brief The number of workers.
+  std::size_t count;
+
+  //! @brief The task slots of the workers.
+  std::unique_ptr<slot[]> slots;
+
+  //! @brief The type erased function of the current run.
+  void (*invoke)(void *, std::size_t){nullptr};
+
+  //! @brief The function object of the current run.
+  void *context{nullptr};
+
+  //! @brief Whether the busy times of the workers are measured.
+  bool timed{false};
+
+  //! @brief The number of workers yet to complete the current run.
+  std::atomic<std::size_t> pending{0};
+
+  //! @brief The number of runs started, guarded by the mutex.
+  std::uint64_t generation{0};
+
+  //! @brief The mutex guarding the start of a run.
+  std::mutex mutex;
+
+  //! @brief The condition the workers wait on for a run to start.
+  std::condition_variable_any condition;
+
+  //! @brief The worker threads, declared last to stop and join first.
+  std::vector<std::jthread> workers;
+};
+
+//! @brief Parses a list of processors, for example "0,2-5".
+//!
+//! @details Returns no list on syntax error or on processors beyond the
+//! addressable processors. An empty string is an empty list.
+[[nodiscard]] inline auto parse_processors(std::string_view list)
+    -> std::optional<std::vector<unsigned>> {
+  std::vector<unsigned> processors;
+  const auto number{[](std::string_view text) -> std::optional<unsigned> {
+    unsigned value{0};
+    const auto *const last{text.data() + text.size()};
+    if (const auto [end, error]{std::from_chars(text.data(), last, value)};
+        error != std::errc{} || end != last) {
+      return std::nullopt;
+    }
+    return value;
+  }};
+  while (!list.empty()) {
+    const auto comma{list.find(',')};
+    const auto item{list.substr(0, comma)};
+    list = comma == std::string_view::npos ? std::string_view{}
+                                           : list.substr(comma + 1);
+    const auto dash{item.find('-')};
+    const auto first{number(item.substr(0, dash))};
+    const auto last{dash == std::string_view::npos
+                        ? first
+                        : number(item.substr(dash + 1))};
+    if (!first || !last || *last < *first || *last >= maximum_processors) {
+      return std::nullopt;
+    }
+    for (auto processor{*first}; processor <= *last; ++processor) {
+      processors.push_back(processor);
+    }
+  }
+  return processors;
+}
+
+} // namespace fcarouge
+
+#endif // FCAROUGE_WORKER_POOL_HPP